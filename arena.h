@@ -0,0 +1,439 @@
+#ifndef ARENA_LIBRARY
+#define ARENA_LIBRARY
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ARENA_MAX_LEN    64
+#define ARENA_FOOD_SCAN  8   // How far (in cells) a snake looks for food
+
+typedef struct Arena Arena_t;
+
+bool ArenaInit(Arena_t *arena, unsigned short rows, unsigned short cols,
+               unsigned snakes, unsigned food, unsigned threads, uint64_t seed);
+
+void ArenaDeinit(Arena_t *arena);
+
+void ArenaStep(Arena_t *arena);
+
+#ifdef ARENA_INCLUDE_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+#define ARENA_EMPTY  0u
+#define ARENA_FOOD   1u
+#define ARENA_SNAKE  2u           // grid value of snake i is ARENA_SNAKE + i
+#define ARENA_NONE   UINT32_MAX   // no claim / no move
+
+typedef struct ArenaWorker ArenaWorker_t;
+
+// Many bot snakes on one board. Snakes are stored as a struct of arrays and
+// all collisions go through one occupancy grid.
+//
+// A tick has three phases:
+//   1. decide (parallel): every snake reads the grid, picks its next cell and
+//      claims it with an atomic minimum of its id, so the lowest id wins.
+//   2. apply  (parallel): winners move. Every cell is written by at most one
+//      snake, because a claimed cell was empty and a vacated cell was its own.
+//   3. serial: respawns dead snakes and tops up the food with the arena PRNG.
+// The result does not depend on the number of threads.
+typedef struct Arena {
+  unsigned short rows, cols;
+  unsigned count;
+  unsigned food_target;
+
+  // Per snake
+  uint32_t *body;        // count * ARENA_MAX_LEN ring buffers of cells
+  uint16_t *start;       // Ring index of the tail
+  uint16_t *length;
+  uint8_t  *dir;
+  uint8_t  *alive;
+  uint32_t *next_cell;
+  uint32_t *score;
+  uint64_t *rng;
+
+  // Per cell
+  uint32_t *grid;
+  _Atomic uint32_t *claim;
+
+  // Stats of the last tick
+  unsigned long long tick;
+  unsigned alive_count, food_count, longest;
+  unsigned long long moves, deaths;
+
+  uint64_t arena_rng;
+
+  // Workers; worker 0 is the caller of ArenaStep(...)
+  unsigned threads;
+  ArenaWorker_t *workers;
+  pthread_barrier_t barrier;
+  pthread_mutex_t start_lock;     // Held by ArenaInit(...) while it starts them
+  bool quit;
+} Arena_t;
+
+typedef struct ArenaWorker {
+  Arena_t *arena;
+  pthread_t thread;
+  unsigned first, last;
+  // Filled in by the apply phase, summed up in the serial phase
+  unsigned eaten, dropped, died, moved;
+} __attribute__((aligned(64))) ArenaWorker_t;
+
+static const int arena_drow[] = { -1, 1, 0,  0 };
+static const int arena_dcol[] = {  0, 0, 1, -1 };
+
+static uint64_t ArenaRandom(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static inline bool ArenaIsWall(const Arena_t *arena, int row, int col) {
+  return row <= 2 || row >= arena->rows - 1 || col <= 2 || col >= arena->cols - 2;
+}
+
+static inline uint32_t ArenaHead(const Arena_t *arena, unsigned i) {
+  return arena->body[i * ARENA_MAX_LEN + (arena->start[i] + arena->length[i] - 1) % ARENA_MAX_LEN];
+}
+
+static uint32_t ArenaRandomCell(Arena_t *arena) {
+  int row = 3 + (int)(ArenaRandom(&arena->arena_rng) % (arena->rows - 4));
+  int col = 3 + (int)(ArenaRandom(&arena->arena_rng) % (arena->cols - 5));
+  return (uint32_t)(row * arena->cols + col);
+}
+
+static void ArenaSpawnSnake(Arena_t *arena, unsigned i) {
+  // A few tries; if the board is full, try again next tick
+  for (int attempt = 0; attempt < 16; attempt++) {
+    uint32_t cell = ArenaRandomCell(arena);
+    if (arena->grid[cell] != ARENA_EMPTY) continue;
+
+    arena->grid[cell] = ARENA_SNAKE + i;
+    arena->body[i * ARENA_MAX_LEN] = cell;
+    arena->start[i] = 0;
+    arena->length[i] = 1;
+    arena->dir[i] = (uint8_t)(ArenaRandom(&arena->arena_rng) % 4);
+    arena->alive[i] = 1;
+    return;
+  }
+}
+
+static void ArenaSpawnFood(Arena_t *arena) {
+  for (unsigned tries = 0; arena->food_count < arena->food_target && tries < arena->food_target * 4; tries++) {
+    uint32_t cell = ArenaRandomCell(arena);
+    if (arena->grid[cell] != ARENA_EMPTY) continue;
+    arena->grid[cell] = ARENA_FOOD;
+    arena->food_count++;
+  }
+}
+
+// Nearest food in a small square around the head, or ARENA_NONE
+static uint32_t ArenaFindFood(const Arena_t *arena, uint32_t head) {
+  int hrow = head / arena->cols, hcol = head % arena->cols;
+  uint32_t best = ARENA_NONE;
+  int best_dist = 1 << 30;
+
+  int r1 = hrow - ARENA_FOOD_SCAN < 3 ? 3 : hrow - ARENA_FOOD_SCAN;
+  int r2 = hrow + ARENA_FOOD_SCAN > arena->rows - 2 ? arena->rows - 2 : hrow + ARENA_FOOD_SCAN;
+  int c1 = hcol - ARENA_FOOD_SCAN < 3 ? 3 : hcol - ARENA_FOOD_SCAN;
+  int c2 = hcol + ARENA_FOOD_SCAN > arena->cols - 3 ? arena->cols - 3 : hcol + ARENA_FOOD_SCAN;
+
+  for (int row = r1; row <= r2; row++) {
+    const uint32_t *line = arena->grid + row * arena->cols;
+    for (int col = c1; col <= c2; col++) {
+      if (line[col] != ARENA_FOOD) continue;
+      int dist = abs(row - hrow) + abs(col - hcol);
+      if (dist < best_dist) {
+        best_dist = dist;
+        best = (uint32_t)(row * arena->cols + col);
+      }
+    }
+  }
+
+  return best;
+}
+
+static void ArenaDecide(Arena_t *arena, unsigned first, unsigned last) {
+  for (unsigned i = first; i < last; i++) {
+    arena->next_cell[i] = ARENA_NONE;
+    if (!arena->alive[i]) continue;
+
+    uint32_t head = ArenaHead(arena, i);
+    int hrow = head / arena->cols, hcol = head % arena->cols;
+    uint32_t food = ArenaFindFood(arena, head);
+
+    // Compared with the heading before this tick, whichever way is scanned first
+    uint8_t heading = arena->dir[i], best_dir = heading;
+    uint32_t best = ARENA_NONE;
+    int best_cost = 1 << 30;
+    unsigned offset = (unsigned)(ArenaRandom(&arena->rng[i]) % 4);
+
+    for (unsigned k = 0; k < 4; k++) {
+      unsigned d = (k + offset) % 4;
+      int row = hrow + arena_drow[d], col = hcol + arena_dcol[d];
+      if (ArenaIsWall(arena, row, col)) continue;
+
+      uint32_t cell = (uint32_t)(row * arena->cols + col);
+      uint32_t value = arena->grid[cell];
+      if (value != ARENA_EMPTY && value != ARENA_FOOD) continue;
+
+      int cost;
+      if (food != ARENA_NONE)
+        cost = abs(row - (int)(food / arena->cols)) + abs(col - (int)(food % arena->cols));
+      else
+        cost = d == heading ? 0 : 1 + (int)(ArenaRandom(&arena->rng[i]) % 8);
+
+      if (cost < best_cost) {
+        best_cost = cost;
+        best = cell;
+        best_dir = (uint8_t)d;
+      }
+    }
+
+    arena->dir[i] = best_dir;
+    arena->next_cell[i] = best;
+    if (best == ARENA_NONE) continue;
+
+    // Deterministic conflict resolution: the lowest id claims the cell
+    uint32_t current = atomic_load_explicit(&arena->claim[best], memory_order_relaxed);
+    while (i < current &&
+           !atomic_compare_exchange_weak_explicit(&arena->claim[best], &current, i,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+  }
+}
+
+static void ArenaKill(Arena_t *arena, ArenaWorker_t *worker, unsigned i) {
+  // The body turns into food, every other cell of it
+  for (unsigned k = 0; k < arena->length[i]; k++) {
+    uint32_t cell = arena->body[i * ARENA_MAX_LEN + (arena->start[i] + k) % ARENA_MAX_LEN];
+    if (k % 2 == 0) {
+      arena->grid[cell] = ARENA_FOOD;
+      worker->dropped++;
+    } else {
+      arena->grid[cell] = ARENA_EMPTY;
+    }
+  }
+
+  arena->alive[i] = 0;
+  arena->length[i] = 0;
+  worker->died++;
+}
+
+static void ArenaApply(Arena_t *arena, ArenaWorker_t *worker) {
+  for (unsigned i = worker->first; i < worker->last; i++) {
+    if (!arena->alive[i]) continue;
+
+    uint32_t next = arena->next_cell[i];
+    if (next == ARENA_NONE) {
+      // Boxed in
+      ArenaKill(arena, worker, i);
+      continue;
+    }
+
+    if (atomic_load_explicit(&arena->claim[next], memory_order_relaxed) != i) {
+      // Lost the cell to a lower id; wait for one tick
+      continue;
+    }
+
+    bool ate = arena->grid[next] == ARENA_FOOD;
+    if (ate) {
+      worker->eaten++;
+      arena->score[i]++;
+    }
+
+    uint32_t *ring = arena->body + i * ARENA_MAX_LEN;
+    if (!ate || arena->length[i] == ARENA_MAX_LEN) {
+      // The tail moves along
+      arena->grid[ring[arena->start[i]]] = ARENA_EMPTY;
+      arena->start[i] = (arena->start[i] + 1) % ARENA_MAX_LEN;
+      arena->length[i]--;
+    }
+
+    ring[(arena->start[i] + arena->length[i]) % ARENA_MAX_LEN] = next;
+    arena->length[i]++;
+    arena->grid[next] = ARENA_SNAKE + i;
+    worker->moved++;
+  }
+}
+
+static void ArenaResetClaims(Arena_t *arena, unsigned first, unsigned last) {
+  for (unsigned i = first; i < last; i++)
+    if (arena->next_cell[i] != ARENA_NONE)
+      atomic_store_explicit(&arena->claim[arena->next_cell[i]], ARENA_NONE, memory_order_relaxed);
+}
+
+static void ArenaRunPhases(Arena_t *arena, ArenaWorker_t *worker) {
+  worker->eaten = worker->dropped = worker->died = worker->moved = 0;
+
+  ArenaDecide(arena, worker->first, worker->last);
+  pthread_barrier_wait(&arena->barrier);
+
+  ArenaApply(arena, worker);
+  pthread_barrier_wait(&arena->barrier);
+
+  ArenaResetClaims(arena, worker->first, worker->last);
+}
+
+static void *ArenaWorkerMain(void *arg) {
+  ArenaWorker_t *worker = arg;
+  Arena_t *arena = worker->arena;
+
+  // Wait until all the workers are started, or ArenaInit(...) gave up
+  pthread_mutex_lock(&arena->start_lock);
+  pthread_mutex_unlock(&arena->start_lock);
+  if (arena->quit) return NULL;
+
+  for (;;) {
+    pthread_barrier_wait(&arena->barrier);
+    if (arena->quit) break;
+
+    ArenaRunPhases(arena, worker);
+    pthread_barrier_wait(&arena->barrier);
+  }
+
+  return NULL;
+}
+
+bool ArenaInit(Arena_t *arena, unsigned short rows, unsigned short cols,
+               unsigned snakes, unsigned food, unsigned threads, uint64_t seed) {
+  size_t cells = (size_t)rows * cols;
+
+  *arena = (Arena_t) { 0 };
+  arena->rows = rows;
+  arena->cols = cols;
+  arena->count = snakes;
+  arena->food_target = food;
+  arena->arena_rng = seed;
+
+  // Small arenas are not worth the barriers
+  if (threads > snakes / 64) threads = snakes / 64;
+  if (threads == 0) threads = 1;
+  arena->threads = threads;
+
+  arena->body      = malloc(sizeof(uint32_t) * snakes * ARENA_MAX_LEN);
+  arena->start     = calloc(snakes, sizeof(uint16_t));
+  arena->length    = calloc(snakes, sizeof(uint16_t));
+  arena->dir       = calloc(snakes, sizeof(uint8_t));
+  arena->alive     = calloc(snakes, sizeof(uint8_t));
+  arena->next_cell = calloc(snakes, sizeof(uint32_t));
+  arena->score     = calloc(snakes, sizeof(uint32_t));
+  arena->rng       = calloc(snakes, sizeof(uint64_t));
+  arena->grid      = calloc(cells, sizeof(uint32_t));
+  arena->claim     = malloc(sizeof(_Atomic uint32_t) * cells);
+  arena->workers   = calloc(threads, sizeof(ArenaWorker_t));
+
+  if (!arena->body || !arena->start || !arena->length || !arena->dir ||
+      !arena->alive || !arena->next_cell || !arena->score || !arena->rng ||
+      !arena->grid || !arena->claim || !arena->workers) {
+    arena->threads = 0;  // No barrier yet
+    ArenaDeinit(arena);
+    return false;
+  }
+
+  for (size_t c = 0; c < cells; c++)
+    atomic_init(&arena->claim[c], ARENA_NONE);
+
+  for (unsigned i = 0; i < snakes; i++) {
+    arena->rng[i] = seed ^ ((i + 1) * 0xD1B54A32D192ED03ull);
+    ArenaSpawnSnake(arena, i);
+  }
+  ArenaSpawnFood(arena);
+
+  pthread_barrier_init(&arena->barrier, NULL, threads);
+  pthread_mutex_init(&arena->start_lock, NULL);
+  pthread_mutex_lock(&arena->start_lock);
+
+  unsigned started;
+  for (started = 0; started < threads; started++) {
+    ArenaWorker_t *worker = &arena->workers[started];
+    worker->arena = arena;
+    worker->first = (unsigned)((unsigned long long)snakes * started / threads);
+    worker->last  = (unsigned)((unsigned long long)snakes * (started + 1) / threads);
+    if (started > 0 && pthread_create(&worker->thread, NULL, ArenaWorkerMain, worker) != 0)
+      break;
+  }
+
+  // The barrier needs all of them, so if one didn't start, the others stop
+  // before they get to it
+  arena->quit = started < threads;
+  pthread_mutex_unlock(&arena->start_lock);
+
+  if (arena->quit) {
+    for (unsigned t = 1; t < started; t++)
+      pthread_join(arena->workers[t].thread, NULL);
+    arena->threads = 1;  // Nobody left to wait for on the barrier
+    ArenaDeinit(arena);
+    return false;
+  }
+
+  return true;
+}
+
+void ArenaDeinit(Arena_t *arena) {
+  if (arena->workers != NULL && arena->threads > 0) {
+    arena->quit = true;
+    if (arena->threads > 1) {
+      pthread_barrier_wait(&arena->barrier);
+      for (unsigned t = 1; t < arena->threads; t++)
+        pthread_join(arena->workers[t].thread, NULL);
+    }
+    pthread_barrier_destroy(&arena->barrier);
+    pthread_mutex_destroy(&arena->start_lock);
+  }
+
+  free(arena->body);      arena->body = NULL;
+  free(arena->start);     arena->start = NULL;
+  free(arena->length);    arena->length = NULL;
+  free(arena->dir);       arena->dir = NULL;
+  free(arena->alive);     arena->alive = NULL;
+  free(arena->next_cell); arena->next_cell = NULL;
+  free(arena->score);     arena->score = NULL;
+  free(arena->rng);       arena->rng = NULL;
+  free(arena->grid);      arena->grid = NULL;
+  free((void *)arena->claim); arena->claim = NULL;
+  free(arena->workers);   arena->workers = NULL;
+}
+
+void ArenaStep(Arena_t *arena) {
+  if (arena->threads > 1)
+    pthread_barrier_wait(&arena->barrier);
+
+  ArenaRunPhases(arena, &arena->workers[0]);
+
+  if (arena->threads > 1)
+    pthread_barrier_wait(&arena->barrier);
+
+  // Serial phase
+  for (unsigned t = 0; t < arena->threads; t++) {
+    const ArenaWorker_t *worker = &arena->workers[t];
+    arena->food_count += worker->dropped;
+    arena->food_count -= worker->eaten;
+    arena->moves += worker->moved;
+    arena->deaths += worker->died;
+  }
+
+  arena->alive_count = 0;
+  arena->longest = 0;
+  for (unsigned i = 0; i < arena->count; i++) {
+    if (!arena->alive[i]) {
+      arena->score[i] = 0;
+      ArenaSpawnSnake(arena, i);
+    }
+    if (arena->alive[i]) arena->alive_count++;
+    if (arena->length[i] > arena->longest) arena->longest = arena->length[i];
+  }
+
+  ArenaSpawnFood(arena);
+  arena->tick++;
+}
+
+#undef ARENA_INCLUDE_IMPL
+#endif // ARENA_INCLUDE_IMPL
+
+#endif // ARENA_LIBRARY
@@ -0,0 +1,560 @@
+// Renderer benchmark: drives the tgui API over several screen sizes and
+// scene workloads and prints one CSV line per case, e.g.
+//
+//   workload,color,cols,rows,frames,ns_per_frame,compose_ns,update_ns,bytes_per_frame,writes_per_frame
+//
+// The output normally goes to a counting sink (no syscalls are made, but
+// they are counted); '--sink devnull' writes to /dev/null to include the
+// kernel's share.
+//
+// '--verify N' checks the encoder instead: it encodes N random frames per
+// color mode, rebuilds the screen from the output with the emulator in
+// emulator.h and compares it with the frames. Palette colors are checked
+// against the xterm palette and a few fixed colors, not against the
+// encoder's own tables. It prints
+//
+//   color,frames,mismatches,bytes_per_frame,sequences_per_frame,moves_per_frame,sgr_per_frame,printed_per_frame,unknown
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+static struct Sink {
+  int fd;  // -1 for the counting sink
+  unsigned long long bytes, writes;
+} sink = { .fd = -1 };
+
+static ssize_t SinkWrite(const void *buff, size_t size) {
+  sink.bytes += size;
+  sink.writes++;
+  return sink.fd < 0 ? (ssize_t)size : write(sink.fd, buff, size);
+}
+
+#define TGUI_WRITE(buff, size) SinkWrite((buff), (size))
+#define TGUI_INCLUDE_IMPL
+#include "tgui.h"
+
+#define GAME_INCLUDE_IMPL
+#include "game.h"
+
+#define BOT_INCLUDE_IMPL
+#include "bot.h"
+
+#define EMULATOR_INCLUDE_IMPL
+#include "emulator.h"
+
+#define WHITE  RGB(25, 25, 25)
+#define GREEN  RGB(0,  245, 0)
+#define RED    RGB(245, 0,  0)
+#define BG     RGB(0,  64, 64)
+
+typedef struct Size { unsigned short cols, rows; } Size_t;
+
+static const Size_t sizes[] = {
+  { 80, 24 }, { 120, 40 }, { 200, 60 }, { 300, 90 }, { 400, 120 }
+};
+
+typedef enum Workload { STATIC_MENU, GAME_TICK, FULL_CLEAR, WORKLOAD_COUNT } Workload_t;
+
+static const char *workload_names[WORKLOAD_COUNT] = { "static_menu", "game_tick", "full_clear" };
+
+static struct Config {
+  long min_time_ms;
+  unsigned long min_frames, max_frames;
+  bool full;  // Redraw every cell, not just the changed ones
+} config = { 300, 10, 2000, false };
+
+// State of the in-game workload
+static Game_t game;
+static Bot_t bot;
+
+static long long NowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Same composition as StartMenuScene in snake.c
+static void ComposeMenu(VTerm_t *vt, unsigned long frame) {
+  static const char *text[] = {
+    "      Play      ",
+    "                ",
+    "      Help      ",
+    "                ",
+    "      Quit      "
+  };
+
+  unsigned short text_width  = strlen(text[0]);
+  unsigned short text_height = sizeof(text) / sizeof(text[0]);
+
+  unsigned short r1 = (vt->rows - text_height) / 2;
+  unsigned short c1 = (vt->cols - text_width)  / 2;
+  unsigned short r2 = (vt->rows + text_height) / 2 + 1;
+  unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
+
+  unsigned short cursor = (frame / 30 % 3) * 2;
+
+  VTermReset(vt, ' ', BG, BG);
+  SetRect(vt, WHITE, BG, r1, c1, r2, c2);
+  SetMultilineText(vt, text, text_height, WHITE, BG, r1 + 1, c1 + 1);
+  SetGlyph(vt, '>', WHITE, BG, r1 + cursor + 1, c1 + 4);
+  SetGlyph(vt, '<', WHITE, BG, r1 + cursor + 1, c2 - 4);
+}
+
+// One autopilot tick and the same composition as DrawBoard in snake.c
+static void ComposeGame(VTerm_t *vt) {
+  MoveDir_t dir = BotNextMove(&bot, &game);
+  if (dir != game.moving_dir) GameSetDirection(&game, dir);
+
+  unsigned events = GameStep(&game);
+  if ((events & (GAME_WON | GAME_LOST)) || game.lifes == 0) {
+    GameReset(&game, true);
+    BotForgetPath(&bot);
+  }
+
+  VTermReset(vt, ' ', BG, BG);
+  SetRect(vt, WHITE, BG, 2, 2, vt->rows - 1, vt->cols - 2);
+
+  char buff[31];
+  sprintf(buff, "Score: %d Best score: %d", game.score, game.best_score);
+  SetText(vt, buff, WHITE, BG, 3, 4);
+
+  sprintf(buff, "Lifes: ");
+  for (unsigned short i = 0; i < game.lifes; i++) strcat(buff, "@ ");
+  SetText(vt, buff, WHITE, BG, 3, vt->cols - 16);
+
+  SetGlyph(vt, '*', RED, BG, game.food.row, game.food.col);
+
+  for (unsigned short i = 0; i < game.snake_length; i++) {
+    char c = game.snake[i].is_head ? '@' : '#';
+    SetGlyph(vt, c, GREEN, BG, game.snake[i].row, game.snake[i].col);
+  }
+}
+
+static void Compose(VTerm_t *vt, Workload_t workload, unsigned long frame) {
+  switch (workload) {
+    case STATIC_MENU: ComposeMenu(vt, frame); break;
+    case GAME_TICK:   ComposeGame(vt); break;
+    case FULL_CLEAR:  VTermReset(vt, ' ', BG, BG); break;
+    default: break;
+  }
+}
+
+static void RunCase(Workload_t workload, ColorMode_t mode, Size_t size) {
+  SetColorMode(mode);
+  InvalidateWindow();
+
+  VTerm_t vt;
+  // The game makes the VTerm one row and col bigger than the window
+  VTermInit(&vt, size.rows + 1, size.cols + 1);
+
+  if (workload == GAME_TICK) {
+    GameInit(&game, vt.rows, vt.cols, 1);
+    if (!BotInit(&bot, vt.rows, vt.cols)) {
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for the autopilot\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Warm up
+  for (unsigned long i = 0; i < 3; i++) {
+    Compose(&vt, workload, i);
+    UpdateWindow(&vt);
+  }
+
+  sink.bytes = sink.writes = 0;
+  long long compose_ns = 0, update_ns = 0;
+  unsigned long frames = 0;
+  long long started = NowNs();
+
+  while (frames < config.max_frames &&
+         (frames < config.min_frames || NowNs() - started < config.min_time_ms * 1000000LL)) {
+    long long t1 = NowNs();
+    Compose(&vt, workload, frames);
+    long long t2 = NowNs();
+    // A full clear means redrawing every cell, which the diff would skip
+    if (config.full || workload == FULL_CLEAR) InvalidateWindow();
+    UpdateWindow(&vt);
+    long long t3 = NowNs();
+
+    compose_ns += t2 - t1;
+    update_ns += t3 - t2;
+    frames++;
+  }
+
+  printf("%s,%s,%u,%u,%lu,%.0f,%.0f,%.0f,%.1f,%.1f\n",
+    workload_names[workload], ColorModeName(mode), size.cols, size.rows, frames,
+    (double)(compose_ns + update_ns) / frames,
+    (double)compose_ns / frames, (double)update_ns / frames,
+    (double)sink.bytes / frames, (double)sink.writes / frames);
+  fflush(stdout);
+
+  if (workload == GAME_TICK) BotDeinit(&bot);
+  VTermDeinit(&vt);
+}
+
+// --verify: random frames, mostly small changes of the one before, like the
+// game makes, and sometimes new sizes and full redraws
+static uint64_t verify_rng = 0x9E3779B97F4A7C15ull;
+
+static uint64_t VerifyRandom(void) {
+  uint64_t z = (verify_rng += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static unsigned VerifyBelow(unsigned n) {
+  return (unsigned)(VerifyRandom() % n);
+}
+
+static Color_t VerifyColor(void) {
+  // Mostly a few colors, so the encoder can reuse them
+  static const Color_t palette[] = {
+    RGB(25, 25, 25), RGB(0, 245, 0), RGB(245, 0, 0), RGB(0, 64, 64),
+    RGB(255, 255, 255), RGB(0, 0, 0), RGB(128, 128, 128), RGB(95, 135, 175)
+  };
+  if (VerifyBelow(5) > 0) return palette[VerifyBelow(sizeof(palette) / sizeof(palette[0]))];
+
+  uint64_t r = VerifyRandom();
+  return RGB((unsigned char)r, (unsigned char)(r >> 8), (unsigned char)(r >> 16));
+}
+
+static char VerifyChar(void) {
+  // Sometimes a cell that is never set, which the terminal keeps as it is
+  return VerifyBelow(50) == 0 ? '\0' : (char)(' ' + VerifyBelow(95));
+}
+
+static void VerifyRandomCell(VTerm_t *vt) {
+  SetGlyph(vt, VerifyChar(), VerifyColor(), VerifyColor(), VerifyBelow(vt->rows), VerifyBelow(vt->cols));
+}
+
+static void NextVerifyFrame(VTerm_t *vt, FrameEncoder_t *enc) {
+  unsigned what = VerifyBelow(100);
+
+  if (what < 2) {
+    VTermResize(vt, 2 + VerifyBelow(60), 2 + VerifyBelow(120));
+  } else if (what < 4) {
+    for (unsigned short i = 0; i < vt->rows; i++)
+      for (unsigned short j = 0; j < vt->cols; j++)
+        SetGlyph(vt, VerifyChar(), VerifyColor(), VerifyColor(), i, j);
+  } else if (what < 8) {
+    VTermReset(vt, VerifyChar(), VerifyColor(), VerifyColor());
+  } else if (what < 20) {
+    // A line of text, cut off at the right edge
+    char text[64];
+    unsigned length = 1 + VerifyBelow(sizeof(text) - 1);
+    for (unsigned i = 0; i < length; i++) text[i] = (char)(' ' + VerifyBelow(95));
+    text[length] = '\0';
+
+    unsigned short row = VerifyBelow(vt->rows), col = VerifyBelow(vt->cols);
+    Color_t fg = VerifyColor(), bg = VerifyColor();
+    for (unsigned i = 0; i < length && col + i < vt->cols; i++)
+      SetGlyph(vt, text[i], fg, bg, row, col + i);
+  } else {
+    for (unsigned n = VerifyBelow(20); n > 0; n--)
+      VerifyRandomCell(vt);
+  }
+
+  if (VerifyBelow(50) == 0) EncoderInvalidate(enc);
+}
+
+// The palette colors the encoder may pick, worked out here from the xterm
+// palette rather than with MapColor(...), so that the check doesn't trust
+// the encoder's own tables. Entries 16 to 231 are the 6x6x6 cube, 232 to
+// 255 the gray ramp.
+static Color_t XtermColor(unsigned char index) {
+  static const unsigned char levels[6] = { 0, 95, 135, 175, 215, 255 };
+  if (index >= 232) {
+    unsigned char gray = (unsigned char)(8 + (index - 232) * 10);
+    return RGB(gray, gray, gray);
+  }
+  index -= 16;
+  return RGB(levels[index / 36], levels[index / 6 % 6], levels[index % 6]);
+}
+
+static int ColorDistance(Color_t a, Color_t b) {
+  int dr = a.r - b.r, dg = a.g - b.g, db = a.b - b.b;
+  return dr * dr + dg * dg + db * db;
+}
+
+// How far 'color' is from the closest of palette entries 16 to 255
+static int NearestXtermDistance(Color_t color) {
+  static const unsigned char levels[6] = { 0, 95, 135, 175, 215, 255 };
+  const unsigned char channels[3] = { color.r, color.g, color.b };
+
+  // The cube is nearest channel by channel
+  int cube = 0;
+  for (int c = 0; c < 3; c++) {
+    int best = 255 * 255;
+    for (int l = 0; l < 6; l++) {
+      int d = (channels[c] - levels[l]) * (channels[c] - levels[l]);
+      if (d < best) best = d;
+    }
+    cube += best;
+  }
+
+  int nearest = cube;
+  for (int gray = 0; gray < 24; gray++) {
+    int d = ColorDistance(color, XtermColor((unsigned char)(232 + gray)));
+    if (d < nearest) nearest = d;
+  }
+  return nearest;
+}
+
+// The 16 color rule of tgui.h, worked out from how it's documented: by the
+// high 4 bits of each channel, the channels at least half as bright as the
+// brightest one are on, bright colors get the bright variant and the grays
+// go to black, dark gray, light gray or white
+static unsigned char ExpectedAnsiColor(Color_t color) {
+  int r = (color.r >> 4) * 17, g = (color.g >> 4) * 17, b = (color.b >> 4) * 17;
+  int max = r;
+  if (g > max) max = g;
+  if (b > max) max = b;
+
+  if (max < 48) return 0;
+  bool red = 2 * r > max, green = 2 * g > max, blue = 2 * b > max;
+  if (red && green && blue) {
+    if (max < 128) return 8;
+    return max < 224 ? 7 : 15;
+  }
+  return (unsigned char)((red ? 1 : 0) + (green ? 2 : 0) + (blue ? 4 : 0) + (max >= 192 ? 8 : 0));
+}
+
+// Fixed colors with the palette entries every xterm-like terminal has for
+// them. Returns false, and tells which, if the encoder maps one differently.
+static bool CheckKnownColors(ColorMode_t mode) {
+  static const struct { Color_t color; unsigned char index_256, index_16; } known[] = {
+    { RGB(0, 0, 0),        16,  0 }, { RGB(255, 255, 255), 231, 15 },
+    { RGB(255, 0, 0),     196,  9 }, { RGB(0, 255, 0),      46, 10 },
+    { RGB(0, 0, 255),      21, 12 }, { RGB(255, 255, 0),   226, 11 },
+    { RGB(255, 0, 255),   201, 13 }, { RGB(0, 255, 255),    51, 14 },
+    { RGB(128, 0, 0),      88,  1 }, { RGB(0, 128, 0),      28,  2 },
+    { RGB(128, 128, 0),   100,  3 }, { RGB(0, 0, 128),      18,  4 },
+    { RGB(128, 0, 128),    90,  5 }, { RGB(0, 128, 128),    30,  6 },
+    { RGB(192, 192, 192), 250,  7 }, { RGB(127, 127, 127), 244,  8 },
+    { RGB(95, 135, 175),   67,  6 }, { RGB(0, 64, 64),      23,  6 },
+    { RGB(25, 25, 25),    234,  0 }, { RGB(8, 8, 8),       232,  0 },
+    { RGB(238, 238, 238), 255, 15 }, { RGB(0, 95, 95),      23,  6 }
+  };
+  if (mode != COLOR_256 && mode != COLOR_16) return true;
+
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+    Color_t color = known[i].color;
+    unsigned char want = mode == COLOR_256 ? known[i].index_256 : known[i].index_16;
+    unsigned char got = MapColor(mode, color).r;
+    if (got == want) continue;
+
+    fprintf(stderr, "  \033[31mError:\033[0m %s maps %u,%u,%u to %u instead of %u\n",
+      ColorModeName(mode), color.r, color.g, color.b, got, want);
+    ok = false;
+  }
+  return ok;
+}
+
+// What the terminal should show: every visible cell that was set, over
+// whatever was there before. The colors are kept as they were set, and
+// SameCell(...) decides if the terminal's color is right for them.
+static void ExpectFrame(Emulator_t *model, const VTerm_t *vt, ColorMode_t mode) {
+  static const EmulatorColorKind_t kinds[COLOR_MODE_COUNT] = {
+    EMULATOR_RGB, EMULATOR_256, EMULATOR_16, EMULATOR_DEFAULT
+  };
+
+  for (unsigned short i = 1; i < vt->rows; i++) {
+    for (unsigned short j = 1; j < vt->cols; j++) {
+      const Glyph_t *glyph = &vt->screen[i][j];
+      if (glyph->value == '\0') continue;
+
+      EmulatorCell_t *cell = (EmulatorCell_t *)EmulatorAt(model, i, j);
+      *cell = (EmulatorCell_t) {
+        .value = glyph->value,
+        .fg_kind = kinds[mode], .bg_kind = kinds[mode],
+        .fg_color = mode == COLOR_MONO ? (Color_t) { 0 } : glyph->fg_color,
+        .bg_color = mode == COLOR_MONO ? (Color_t) { 0 } : glyph->bg_color
+      };
+    }
+  }
+}
+
+// Whether the terminal shows 'got' for 'want', a color in ExpectFrame(...)
+static bool ShowsColor(EmulatorColorKind_t kind, Color_t got, Color_t want) {
+  switch (kind) {
+    case EMULATOR_256:
+      // Any of the nearest entries, as ties could go either way
+      return got.r >= 16 && got.g == 0 && got.b == 0 &&
+        ColorDistance(want, XtermColor(got.r)) == NearestXtermDistance(want);
+    case EMULATOR_16:
+      return got.r == ExpectedAnsiColor(want) && got.g == 0 && got.b == 0;
+    default:
+      return got.r == want.r && got.g == want.g && got.b == want.b;
+  }
+}
+
+static bool SameCell(const EmulatorCell_t *got, const EmulatorCell_t *want) {
+  return got->value == want->value &&
+    got->fg_kind == want->fg_kind && got->bg_kind == want->bg_kind &&
+    ShowsColor(want->fg_kind, got->fg_color, want->fg_color) &&
+    ShowsColor(want->bg_kind, got->bg_color, want->bg_color);
+}
+
+// Returns false at the first frame the emulator shows differently
+static bool RunVerify(ColorMode_t mode, unsigned long frames) {
+  VTerm_t vt;
+  VTermInit(&vt, 25, 81);
+  VTermReset(&vt, ' ', RGB(25, 25, 25), RGB(0, 64, 64));
+
+  FrameEncoder_t enc;
+  EncoderInit(&enc);
+  EncoderSetColorMode(&enc, mode);
+
+  // The terminal and what it should show, both the visible part of 'vt'
+  Emulator_t term, model;
+  if (!EmulatorInit(&term, vt.rows - 1, vt.cols - 1) || !EmulatorInit(&model, vt.rows - 1, vt.cols - 1)) {
+    fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for the emulator\n");
+    exit(EXIT_FAILURE);
+  }
+
+  bool known = CheckKnownColors(mode);
+  unsigned long frame, mismatches = 0;
+  for (frame = 0; frame < frames && mismatches == 0; frame++) {
+    if (frame > 0) NextVerifyFrame(&vt, &enc);
+
+    if (term.rows != vt.rows - 1 || term.cols != vt.cols - 1) {
+      if (!EmulatorResize(&term, vt.rows - 1, vt.cols - 1) || !EmulatorResize(&model, vt.rows - 1, vt.cols - 1)) {
+        fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for the emulator\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    size_t size;
+    const char *data = EncodeFrame(&enc, &vt, &size);
+
+    // In two parts, as a terminal may read it
+    size_t split = size > 0 ? VerifyBelow((unsigned)size + 1) : 0;
+    EmulatorFeed(&term, data, split);
+    EmulatorFeed(&term, data + split, size - split);
+
+    ExpectFrame(&model, &vt, mode);
+
+    for (unsigned short i = 1; i <= term.rows && mismatches == 0; i++) {
+      for (unsigned short j = 1; j <= term.cols; j++) {
+        const EmulatorCell_t *got = EmulatorAt(&term, i, j), *want = EmulatorAt(&model, i, j);
+        if (SameCell(got, want)) continue;
+
+        fprintf(stderr, "  \033[31mError:\033[0m %s frame %lu (%ux%u), cell %u;%u: '%c' %u/%u,%u,%u on %u/%u,%u,%u instead of '%c' %u/%u,%u,%u on %u/%u,%u,%u\n",
+          ColorModeName(mode), frame, term.rows, term.cols, i, j,
+          got->value, got->fg_kind, got->fg_color.r, got->fg_color.g, got->fg_color.b,
+          got->bg_kind, got->bg_color.r, got->bg_color.g, got->bg_color.b,
+          want->value, want->fg_kind, want->fg_color.r, want->fg_color.g, want->fg_color.b,
+          want->bg_kind, want->bg_color.r, want->bg_color.g, want->bg_color.b);
+        mismatches++;
+        break;
+      }
+    }
+  }
+
+  const EmulatorCounts_t *counts = &term.counts;
+  printf("%s,%lu,%lu,%.1f,%.1f,%.1f,%.1f,%.1f,%llu\n",
+    ColorModeName(mode), frame, mismatches,
+    (double)counts->bytes / frame, (double)counts->sequences / frame,
+    (double)counts->moves / frame, (double)counts->sgr / frame,
+    (double)counts->printed / frame, (unsigned long long)counts->unknown);
+  fflush(stdout);
+
+  bool ok = known && mismatches == 0 && counts->unknown == 0;
+  EmulatorDeinit(&model);
+  EmulatorDeinit(&term);
+  EncoderDeinit(&enc);
+  VTermDeinit(&vt);
+  return ok;
+}
+
+static void PrintUsage(const char *name) {
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  --sink count|devnull  count the output only, or also write it to /dev/null\n"
+    "  --time MS             minimum time per case (default %ld)\n"
+    "  --frames N            maximum frames per case (default %lu)\n"
+    "  --full                redraw every cell in every frame\n"
+    "  --color MODE          true, 256, 16, mono or all (default true, all with --verify)\n"
+    "  --verify N            check N random frames per color mode with a terminal emulator\n",
+    name, config.min_time_ms, config.max_frames);
+}
+
+int main(int argc, char **argv) {
+  ColorMode_t first_mode = COLOR_TRUE, last_mode = COLOR_TRUE;
+  bool color_given = false;
+  unsigned long verify_frames = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--sink") == 0 && i + 1 < argc) {
+      const char *kind = argv[++i];
+      if (strcmp(kind, "devnull") == 0) {
+        sink.fd = open("/dev/null", O_WRONLY);
+        if (sink.fd < 0) {
+          fprintf(stderr, "  \033[31mError:\033[0m Couldn't open /dev/null\n");
+          return EXIT_FAILURE;
+        }
+      } else if (strcmp(kind, "count") != 0) {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+      config.min_time_ms = strtol(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--full") == 0) {
+      config.full = true;
+    } else if (strcmp(argv[i], "--color") == 0 && i + 1 < argc) {
+      const char *name = argv[++i];
+      ColorMode_t mode;
+      color_given = true;
+      if (strcmp(name, "all") == 0) {
+        first_mode = COLOR_TRUE;
+        last_mode = COLOR_MONO;
+      } else if (ColorModeFromName(name, &mode)) {
+        first_mode = last_mode = mode;
+      } else {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc) {
+      verify_frames = strtoul(argv[++i], NULL, 10);
+      if (verify_frames == 0) verify_frames = 1;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      config.max_frames = strtoul(argv[++i], NULL, 10);
+      if (config.max_frames == 0) config.max_frames = 1;
+      if (config.min_frames > config.max_frames) config.min_frames = config.max_frames;
+    } else {
+      PrintUsage(argv[0]);
+      return strcmp(argv[i], "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  if (verify_frames > 0) {
+    if (!color_given) {
+      first_mode = COLOR_TRUE;
+      last_mode = COLOR_MONO;
+    }
+
+    printf("color,frames,mismatches,bytes_per_frame,sequences_per_frame,moves_per_frame,sgr_per_frame,printed_per_frame,unknown\n");
+
+    bool ok = true;
+    for (unsigned m = first_mode; m <= last_mode; m++)
+      ok = RunVerify((ColorMode_t)m, verify_frames) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  printf("workload,color,cols,rows,frames,ns_per_frame,compose_ns,update_ns,bytes_per_frame,writes_per_frame\n");
+
+  for (unsigned w = 0; w < WORKLOAD_COUNT; w++)
+    for (unsigned m = first_mode; m <= last_mode; m++)
+      for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+        RunCase((Workload_t)w, (ColorMode_t)m, sizes[s]);
+
+  if (sink.fd >= 0) close(sink.fd);
+  return EXIT_SUCCESS;
+}
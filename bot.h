@@ -0,0 +1,339 @@
+#ifndef BOT_LIBRARY
+#define BOT_LIBRARY
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "game.h"
+
+// Default planning budget per tick
+#define BOT_BUDGET_NS 200000
+
+typedef struct Bot Bot_t;
+
+bool BotInit(Bot_t *bot, unsigned short rows, unsigned short cols);
+
+void BotDeinit(Bot_t *bot);
+
+void BotForgetPath(Bot_t *bot);
+
+MoveDir_t BotNextMove(Bot_t *bot, const Game_t *game);
+
+#ifdef BOT_INCLUDE_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Autopilot. Finds the food with a BFS over the board where every body
+// part blocks its cell only until the tail has moved past it. The found
+// path is kept and repaired in place on the following ticks instead of
+// searching the whole board again. If there is no path to the food, it
+// follows its own tail, and if even that fails, it picks the neighbour
+// with the most free space around it.
+//
+// All buffers are allocated once in BotInit(...) and reused; "stamps"
+// mark which entries are valid, so nothing has to be cleared per tick.
+typedef struct Bot {
+  unsigned short rows, cols;
+
+  // Body grid: free_at[cell] is the number of ticks until the cell is
+  // free, valid only where body_stamp[cell] == tick_stamp
+  uint32_t *body_stamp;
+  uint16_t *free_at;
+  uint32_t tick_stamp;
+
+  // BFS buffers, valid only where visit_stamp[cell] == search_stamp
+  uint32_t *visit_stamp;
+  int *parent;
+  int *dist;
+  int *queue;
+  uint32_t search_stamp;
+
+  // Cached path towards path_goal; path[path_pos] is the next step
+  int *path, *scratch;
+  int path_len, path_pos, path_goal;
+
+  // Planning time limit per tick (0 means unlimited, which is deterministic)
+  long budget_ns;
+  long last_ns, max_ns;
+  struct timespec started;
+  bool out_of_budget;
+} Bot_t;
+
+static const int bot_drow[] = { -1, 1, 0,  0 };
+static const int bot_dcol[] = {  0, 0, 1, -1 };
+static const MoveDir_t bot_dirs[] = { UP, DOWN, RIGHT, LEFT };
+
+bool BotInit(Bot_t *bot, unsigned short rows, unsigned short cols) {
+  size_t cells = (size_t)rows * cols;
+
+  *bot = (Bot_t) { 0 };
+  bot->rows = rows;
+  bot->cols = cols;
+  bot->budget_ns = BOT_BUDGET_NS;
+
+  bot->body_stamp  = calloc(cells, sizeof(uint32_t));
+  bot->free_at     = calloc(cells, sizeof(uint16_t));
+  bot->visit_stamp = calloc(cells, sizeof(uint32_t));
+  bot->parent      = malloc(cells * sizeof(int));
+  bot->dist        = malloc(cells * sizeof(int));
+  bot->queue       = malloc(cells * sizeof(int));
+  bot->path        = malloc(cells * sizeof(int));
+  bot->scratch     = malloc(cells * sizeof(int));
+
+  if (!bot->body_stamp || !bot->free_at || !bot->visit_stamp || !bot->parent ||
+      !bot->dist || !bot->queue || !bot->path || !bot->scratch) {
+    BotDeinit(bot);
+    return false;
+  }
+
+  return true;
+}
+
+void BotDeinit(Bot_t *bot) {
+  free(bot->body_stamp);  bot->body_stamp = NULL;
+  free(bot->free_at);     bot->free_at = NULL;
+  free(bot->visit_stamp); bot->visit_stamp = NULL;
+  free(bot->parent);      bot->parent = NULL;
+  free(bot->dist);        bot->dist = NULL;
+  free(bot->queue);       bot->queue = NULL;
+  free(bot->path);        bot->path = NULL;
+  free(bot->scratch);     bot->scratch = NULL;
+}
+
+void BotForgetPath(Bot_t *bot) {
+  bot->path_len = 0;
+  bot->path_pos = 0;
+  bot->path_goal = -1;
+}
+
+static long BotElapsedNs(const Bot_t *bot) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - bot->started.tv_sec) * 1000000000L + (now.tv_nsec - bot->started.tv_nsec);
+}
+
+static inline int BotCell(const Bot_t *bot, int row, int col) {
+  return row * bot->cols + col;
+}
+
+static inline bool BotIsWall(const Bot_t *bot, int row, int col) {
+  return row <= 2 || row >= bot->rows - 1 || col <= 2 || col >= bot->cols - 2;
+}
+
+// Can the snake be on 'cell' after 'depth' moves?
+static inline bool BotIsPassable(const Bot_t *bot, int cell, int depth) {
+  int row = cell / bot->cols, col = cell % bot->cols;
+  if (BotIsWall(bot, row, col)) return false;
+  if (bot->body_stamp[cell] != bot->tick_stamp) return true;
+  return bot->free_at[cell] <= depth;
+}
+
+static void BotNextStamp(uint32_t *stamp, uint32_t *grid, size_t cells) {
+  if (++*stamp == 0) {
+    memset(grid, 0, cells * sizeof(uint32_t));
+    *stamp = 1;
+  }
+}
+
+static void BotMarkBody(Bot_t *bot, const Game_t *game) {
+  BotNextStamp(&bot->tick_stamp, bot->body_stamp, (size_t)bot->rows * bot->cols);
+
+  unsigned short len = game->snake_length;
+  for (unsigned short i = 0; i < len; i++) {
+    const SnakePart_t *part = &game->snake[i];
+    if (part->row >= bot->rows || part->col >= bot->cols) continue;
+
+    int cell = BotCell(bot, part->row, part->col);
+    uint16_t until = len - i;
+    // Keep the later time if two parts share a cell
+    if (bot->body_stamp[cell] != bot->tick_stamp || bot->free_at[cell] < until) {
+      bot->body_stamp[cell] = bot->tick_stamp;
+      bot->free_at[cell] = until;
+    }
+  }
+}
+
+// BFS from 'start' (reached after 'depth0' moves) to 'goal'. On success the
+// steps, excluding 'start', are written to 'out' and their count returned.
+// Returns -1 if there is no path and -2 if the budget ran out.
+static int BotSearch(Bot_t *bot, int start, int depth0, int goal, MoveDir_t forbidden, int *out) {
+  BotNextStamp(&bot->search_stamp, bot->visit_stamp, (size_t)bot->rows * bot->cols);
+
+  int head = 0, tail = 0;
+  bot->queue[tail++] = start;
+  bot->visit_stamp[start] = bot->search_stamp;
+  bot->parent[start] = -1;
+  bot->dist[start] = depth0;
+
+  unsigned pops = 0;
+  while (head < tail) {
+    if (bot->budget_ns > 0 && (++pops & 63) == 0 && BotElapsedNs(bot) > bot->budget_ns) {
+      bot->out_of_budget = true;
+      return -2;
+    }
+
+    int cell = bot->queue[head++];
+    int row = cell / bot->cols, col = cell % bot->cols;
+
+    if (cell == goal) {
+      int count = bot->dist[cell] - depth0;
+      for (int i = count - 1, c = cell; i >= 0; i--, c = bot->parent[c])
+        out[i] = c;
+      return count;
+    }
+
+    for (int d = 0; d < 4; d++) {
+      // Turning back from the start is a self-collision in this game
+      if (cell == start && bot_dirs[d] == forbidden) continue;
+
+      int next = BotCell(bot, row + bot_drow[d], col + bot_dcol[d]);
+      if (bot->visit_stamp[next] == bot->search_stamp) continue;
+      if (!BotIsPassable(bot, next, bot->dist[cell] + 1)) continue;
+
+      bot->visit_stamp[next] = bot->search_stamp;
+      bot->parent[next] = cell;
+      bot->dist[next] = bot->dist[cell] + 1;
+      bot->queue[tail++] = next;
+    }
+  }
+
+  return -1;
+}
+
+static MoveDir_t BotReverse(MoveDir_t dir) {
+  switch (dir) {
+    case UP:    return DOWN;
+    case DOWN:  return UP;
+    case RIGHT: return LEFT;
+    case LEFT:  return RIGHT;
+    default:    return IDLE;
+  }
+}
+
+static MoveDir_t BotDirTo(const Bot_t *bot, int from, int to) {
+  int drow = to / bot->cols - from / bot->cols;
+  int dcol = to % bot->cols - from % bot->cols;
+  for (int d = 0; d < 4; d++)
+    if (bot_drow[d] == drow && bot_dcol[d] == dcol) return bot_dirs[d];
+  return IDLE;
+}
+
+// Checks the cached path against the current body and repairs it from the
+// first blocked step. Returns false if it has to be planned from scratch.
+static bool BotRepairPath(Bot_t *bot, int head, int goal, MoveDir_t forbidden) {
+  if (bot->path_goal != goal || bot->path_pos >= bot->path_len) return false;
+
+  // The snake must have taken the step we suggested last tick
+  int expected = bot->path_pos > 0 ? bot->path[bot->path_pos - 1] : -1;
+  if (expected != head) return false;
+
+  // Drop the steps already taken
+  int remaining = bot->path_len - bot->path_pos;
+  memmove(bot->path, bot->path + bot->path_pos, remaining * sizeof(int));
+  bot->path_len = remaining;
+  bot->path_pos = 0;
+
+  if (BotDirTo(bot, head, bot->path[0]) == forbidden) return false;
+
+  int blocked = -1;
+  for (int i = 0; i < bot->path_len; i++) {
+    if (!BotIsPassable(bot, bot->path[i], i + 1)) {
+      blocked = i;
+      break;
+    }
+  }
+  if (blocked < 0) return true;
+
+  // Keep the prefix, search again from the last good step
+  int from = blocked > 0 ? bot->path[blocked - 1] : head;
+  MoveDir_t from_forbidden = blocked > 0
+    ? BotReverse(BotDirTo(bot, blocked > 1 ? bot->path[blocked - 2] : head, from))
+    : forbidden;
+
+  int count = BotSearch(bot, from, blocked, goal, from_forbidden, bot->scratch);
+  if (count <= 0) return false;
+
+  memcpy(bot->path + blocked, bot->scratch, count * sizeof(int));
+  bot->path_len = blocked + count;
+  return true;
+}
+
+// Last resort: the neighbour with the most passable cells around it
+static MoveDir_t BotSurvive(Bot_t *bot, int head, MoveDir_t forbidden, MoveDir_t current) {
+  MoveDir_t best = current == IDLE ? UP : current;
+  int best_score = -1;
+
+  int row = head / bot->cols, col = head % bot->cols;
+  for (int d = 0; d < 4; d++) {
+    if (bot_dirs[d] == forbidden) continue;
+
+    int nrow = row + bot_drow[d], ncol = col + bot_dcol[d];
+    int next = BotCell(bot, nrow, ncol);
+    if (!BotIsPassable(bot, next, 1)) continue;
+
+    int score = 0;
+    for (int e = 0; e < 4; e++) {
+      int around = BotCell(bot, nrow + bot_drow[e], ncol + bot_dcol[e]);
+      if (around != head && BotIsPassable(bot, around, 2)) score++;
+    }
+
+    if (score > best_score) {
+      best_score = score;
+      best = bot_dirs[d];
+    }
+  }
+
+  return best;
+}
+
+MoveDir_t BotNextMove(Bot_t *bot, const Game_t *game) {
+  clock_gettime(CLOCK_MONOTONIC, &bot->started);
+  bot->out_of_budget = false;
+
+  // Nothing to plan once the head is in a wall
+  if (BotIsWall(bot, game->snake[0].row, game->snake[0].col))
+    return game->moving_dir;
+
+  BotMarkBody(bot, game);
+
+  int head = BotCell(bot, game->snake[0].row, game->snake[0].col);
+  int food = BotCell(bot, game->food.row, game->food.col);
+  MoveDir_t forbidden = game->snake_length > 1 ? BotReverse(game->moving_dir) : IDLE;
+  MoveDir_t move = IDLE;
+
+  if (BotRepairPath(bot, head, food, forbidden)) {
+    move = BotDirTo(bot, head, bot->path[0]);
+  } else {
+    BotForgetPath(bot);
+
+    int count = BotSearch(bot, head, 0, food, forbidden, bot->path);
+    if (count > 0) {
+      bot->path_len = count;
+      bot->path_goal = food;
+      move = BotDirTo(bot, head, bot->path[0]);
+    } else if (!bot->out_of_budget && game->snake_length > 1) {
+      // No way to the food right now: chase the tail until one opens up
+      const SnakePart_t *tail = &game->snake[game->snake_length - 1];
+      int goal = BotCell(bot, tail->row, tail->col);
+      if (BotSearch(bot, head, 0, goal, forbidden, bot->scratch) > 0)
+        move = BotDirTo(bot, head, bot->scratch[0]);
+    }
+  }
+
+  if (move == IDLE)
+    move = BotSurvive(bot, head, forbidden, game->moving_dir);
+  else if (bot->path_len > 0 && bot->path_goal == food)
+    bot->path_pos = 1;
+
+  bot->last_ns = BotElapsedNs(bot);
+  if (bot->last_ns > bot->max_ns) bot->max_ns = bot->last_ns;
+
+  return move;
+}
+
+#undef BOT_INCLUDE_IMPL
+#endif // BOT_INCLUDE_IMPL
+
+#endif // BOT_LIBRARY
@@ -0,0 +1,337 @@
+#ifndef EMULATOR_LIBRARY
+#define EMULATOR_LIBRARY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tgui.h"
+
+// How a cell's color was set
+typedef enum EmulatorColorKind {
+  EMULATOR_DEFAULT,   // Never set, or reset with SGR 0
+  EMULATOR_RGB,       // 38;2;R;G;B, in 'r', 'g' and 'b'
+  EMULATOR_256,       // 38;5;N, N in 'r'
+  EMULATOR_16         // 30-37 and 90-97, 0 to 15 in 'r'
+} EmulatorColorKind_t;
+
+typedef struct EmulatorCell {
+  char value;
+  EmulatorColorKind_t fg_kind, bg_kind;
+  Color_t fg_color, bg_color;
+} EmulatorCell_t;
+
+// What the terminal got, summed up over everything fed so far
+typedef struct EmulatorCounts {
+  uint64_t bytes;
+  uint64_t sequences;   // All escape sequences
+  uint64_t moves;       // Cursor moves
+  uint64_t sgr;         // Color changes
+  uint64_t printed;     // Characters put on the screen
+  uint64_t unknown;     // Bytes and sequences the emulator doesn't know
+} EmulatorCounts_t;
+
+typedef struct Emulator Emulator_t;
+
+bool EmulatorInit(Emulator_t *emu, unsigned short rows, unsigned short cols);
+
+void EmulatorDeinit(Emulator_t *emu);
+
+bool EmulatorResize(Emulator_t *emu, unsigned short rows, unsigned short cols);
+
+void EmulatorFeed(Emulator_t *emu, const char *data, size_t size);
+
+const EmulatorCell_t *EmulatorAt(const Emulator_t *emu, unsigned short row, unsigned short col);
+
+#ifdef EMULATOR_INCLUDE_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+
+// A terminal that understands what tgui.h writes, e.g. to check that
+// EncodeFrame(...) output rebuilds the frame. Like xterm, the cursor stays
+// on the last column after printing there and wraps with the next
+// character, scrolling at the bottom. CAN and SUB abort a sequence.
+#define EMULATOR_MAX_PARAMS 16
+
+typedef enum EmulatorState { EMULATOR_GROUND, EMULATOR_ESCAPE, EMULATOR_CSI } EmulatorState_t;
+
+typedef struct Emulator {
+  unsigned short rows, cols;
+  EmulatorCell_t *cells;          // rows * cols
+
+  unsigned short row, col;        // Cursor, from 0
+  bool wrap_pending;
+  bool cursor_visible;
+  EmulatorColorKind_t fg_kind, bg_kind;
+  Color_t fg_color, bg_color;
+
+  // The sequence being parsed
+  EmulatorState_t state;
+  bool private_marker;            // CSI ? ...
+  unsigned params[EMULATOR_MAX_PARAMS];
+  unsigned param_count;
+
+  EmulatorCounts_t counts;
+} Emulator_t;
+
+static EmulatorCell_t EmulatorBlank(const Emulator_t *emu) {
+  return (EmulatorCell_t) {
+    .value = ' ',
+    .fg_kind = EMULATOR_DEFAULT, .bg_kind = emu->bg_kind,
+    .bg_color = emu->bg_color
+  };
+}
+
+bool EmulatorInit(Emulator_t *emu, unsigned short rows, unsigned short cols) {
+  *emu = (Emulator_t) { .cursor_visible = true };
+  return EmulatorResize(emu, rows, cols);
+}
+
+void EmulatorDeinit(Emulator_t *emu) {
+  free(emu->cells);
+  *emu = (Emulator_t) { 0 };
+}
+
+// Keeps what fits, like a terminal window that changes size
+bool EmulatorResize(Emulator_t *emu, unsigned short rows, unsigned short cols) {
+  if (rows == 0 || cols == 0) return false;
+
+  EmulatorCell_t *cells = (EmulatorCell_t*) malloc(sizeof(EmulatorCell_t) * rows * cols);
+  if (cells == NULL) return false;
+
+  EmulatorCell_t blank = { .value = ' ' };
+  for (unsigned short i = 0; i < rows; i++) {
+    for (unsigned short j = 0; j < cols; j++) {
+      bool kept = i < emu->rows && j < emu->cols;
+      cells[(size_t)i * cols + j] = kept ? emu->cells[(size_t)i * emu->cols + j] : blank;
+    }
+  }
+
+  free(emu->cells);
+  emu->cells = cells;
+  emu->rows = rows;
+  emu->cols = cols;
+  if (emu->row >= rows) emu->row = rows - 1;
+  if (emu->col >= cols) emu->col = cols - 1;
+  emu->wrap_pending = false;
+  return true;
+}
+
+// Row and col start from 1, like in the escape sequences
+const EmulatorCell_t *EmulatorAt(const Emulator_t *emu, unsigned short row, unsigned short col) {
+  if (row < 1 || col < 1 || row > emu->rows || col > emu->cols) return NULL;
+  return &emu->cells[(size_t)(row - 1) * emu->cols + (col - 1)];
+}
+
+static void EmulatorClear(Emulator_t *emu) {
+  EmulatorCell_t blank = EmulatorBlank(emu);
+  for (size_t i = 0; i < (size_t)emu->rows * emu->cols; i++)
+    emu->cells[i] = blank;
+}
+
+static void EmulatorLineFeed(Emulator_t *emu) {
+  if (emu->row + 1 < emu->rows) {
+    emu->row++;
+    return;
+  }
+
+  // Scroll up
+  memmove(emu->cells, emu->cells + emu->cols, sizeof(EmulatorCell_t) * (emu->rows - 1) * emu->cols);
+  EmulatorCell_t blank = EmulatorBlank(emu);
+  for (unsigned short j = 0; j < emu->cols; j++)
+    emu->cells[(size_t)(emu->rows - 1) * emu->cols + j] = blank;
+}
+
+static void EmulatorPrint(Emulator_t *emu, char value) {
+  if (emu->wrap_pending) {
+    emu->wrap_pending = false;
+    emu->col = 0;
+    EmulatorLineFeed(emu);
+  }
+
+  emu->cells[(size_t)emu->row * emu->cols + emu->col] = (EmulatorCell_t) {
+    .value = value,
+    .fg_kind = emu->fg_kind, .bg_kind = emu->bg_kind,
+    .fg_color = emu->fg_color, .bg_color = emu->bg_color
+  };
+  emu->counts.printed++;
+
+  if (emu->col + 1 < emu->cols)
+    emu->col++;
+  else
+    emu->wrap_pending = true;
+}
+
+// 38 or 48 and what follows them. Returns how many parameters it used.
+static unsigned EmulatorExtendedColor(Emulator_t *emu, unsigned at, bool fg) {
+  const unsigned *p = emu->params + at;
+  unsigned left = emu->param_count - at;
+
+  EmulatorColorKind_t kind;
+  Color_t color = { 0 };
+  unsigned used;
+
+  if (left >= 5 && p[1] == 2 && p[2] < 256 && p[3] < 256 && p[4] < 256) {
+    kind = EMULATOR_RGB;
+    color = (Color_t) { (unsigned char)p[2], (unsigned char)p[3], (unsigned char)p[4] };
+    used = 5;
+  } else if (left >= 3 && p[1] == 5 && p[2] < 256) {
+    kind = EMULATOR_256;
+    color.r = (unsigned char)p[2];
+    used = 3;
+  } else {
+    emu->counts.unknown++;
+    return left;
+  }
+
+  if (fg) {
+    emu->fg_kind = kind;
+    emu->fg_color = color;
+  } else {
+    emu->bg_kind = kind;
+    emu->bg_color = color;
+  }
+  return used;
+}
+
+static void EmulatorSgr(Emulator_t *emu) {
+  emu->counts.sgr++;
+  if (emu->param_count == 0) emu->params[emu->param_count++] = 0;
+
+  for (unsigned i = 0; i < emu->param_count; ) {
+    unsigned p = emu->params[i];
+
+    if (p == 0) {
+      emu->fg_kind = emu->bg_kind = EMULATOR_DEFAULT;
+      emu->fg_color = emu->bg_color = (Color_t) { 0 };
+    } else if ((p >= 30 && p <= 37) || (p >= 90 && p <= 97)) {
+      emu->fg_kind = EMULATOR_16;
+      emu->fg_color = (Color_t) { (unsigned char)(p < 90 ? p - 30 : p - 90 + 8), 0, 0 };
+    } else if ((p >= 40 && p <= 47) || (p >= 100 && p <= 107)) {
+      emu->bg_kind = EMULATOR_16;
+      emu->bg_color = (Color_t) { (unsigned char)(p < 100 ? p - 40 : p - 100 + 8), 0, 0 };
+    } else if (p == 39) {
+      emu->fg_kind = EMULATOR_DEFAULT;
+      emu->fg_color = (Color_t) { 0 };
+    } else if (p == 49) {
+      emu->bg_kind = EMULATOR_DEFAULT;
+      emu->bg_color = (Color_t) { 0 };
+    } else if (p == 38 || p == 48) {
+      i += EmulatorExtendedColor(emu, i, p == 38);
+      continue;
+    } else {
+      emu->counts.unknown++;
+    }
+    i++;
+  }
+}
+
+static void EmulatorCsi(Emulator_t *emu, char final) {
+  emu->counts.sequences++;
+  unsigned *p = emu->params;
+
+  if (emu->private_marker) {
+    // Only showing and hiding the cursor
+    if ((final == 'h' || final == 'l') && emu->param_count == 1 && p[0] == 25)
+      emu->cursor_visible = final == 'h';
+    else
+      emu->counts.unknown++;
+    return;
+  }
+
+  switch (final) {
+    case 'H':
+    case 'f': {
+      // Missing or 0 is the first row or col
+      unsigned row = emu->param_count > 0 && p[0] > 0 ? p[0] : 1u;
+      unsigned col = emu->param_count > 1 && p[1] > 0 ? p[1] : 1u;
+      emu->row = (unsigned short)(row < emu->rows ? row - 1 : emu->rows - 1u);
+      emu->col = (unsigned short)(col < emu->cols ? col - 1 : emu->cols - 1u);
+      emu->wrap_pending = false;
+      emu->counts.moves++;
+      break;
+    }
+    case 'J':
+      if (emu->param_count == 1 && p[0] == 2)
+        EmulatorClear(emu);
+      else
+        emu->counts.unknown++;
+      break;
+    case 'm':
+      EmulatorSgr(emu);
+      break;
+    default:
+      emu->counts.unknown++;
+      break;
+  }
+}
+
+// Parses 'data' as the terminal would, also when a sequence is split
+// between two calls
+void EmulatorFeed(Emulator_t *emu, const char *data, size_t size) {
+  emu->counts.bytes += size;
+
+  for (size_t i = 0; i < size; i++) {
+    unsigned char c = (unsigned char)data[i];
+
+    // Abort whatever sequence is going on
+    if (c == 0x18 || c == 0x1A) {
+      emu->state = EMULATOR_GROUND;
+      continue;
+    }
+
+    switch (emu->state) {
+      case EMULATOR_GROUND:
+        if (c == 0x1B) {
+          emu->state = EMULATOR_ESCAPE;
+        } else if (c >= 0x20 && c < 0x7F) {
+          EmulatorPrint(emu, (char)c);
+        } else if (c == '\r') {
+          emu->col = 0;
+          emu->wrap_pending = false;
+        } else if (c == '\n') {
+          EmulatorLineFeed(emu);
+        } else {
+          emu->counts.unknown++;
+        }
+        break;
+
+      case EMULATOR_ESCAPE:
+        if (c == '[') {
+          emu->state = EMULATOR_CSI;
+          emu->private_marker = false;
+          emu->param_count = 0;
+        } else {
+          emu->counts.sequences++;
+          emu->counts.unknown++;
+          emu->state = EMULATOR_GROUND;
+        }
+        break;
+
+      case EMULATOR_CSI:
+        if (c >= '0' && c <= '9') {
+          if (emu->param_count == 0) emu->params[emu->param_count++] = 0;
+          unsigned *param = &emu->params[emu->param_count - 1];
+          if (*param < 100000) *param = *param * 10 + (c - '0');
+        } else if (c == ';') {
+          if (emu->param_count == 0) emu->params[emu->param_count++] = 0;
+          if (emu->param_count < EMULATOR_MAX_PARAMS)
+            emu->params[emu->param_count++] = 0;
+        } else if (c == '?' && emu->param_count == 0) {
+          emu->private_marker = true;
+        } else if (c >= 0x40 && c <= 0x7E) {
+          EmulatorCsi(emu, (char)c);
+          emu->state = EMULATOR_GROUND;
+        } else {
+          emu->counts.unknown++;
+        }
+        break;
+    }
+  }
+}
+
+#undef EMULATOR_INCLUDE_IMPL
+#endif // EMULATOR_INCLUDE_IMPL
+
+#endif // EMULATOR_LIBRARY
@@ -0,0 +1,258 @@
+#ifndef EXPORT_LIBRARY
+#define EXPORT_LIBRARY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "tgui.h"
+
+#define EXPORT_VERSION 1
+#define EXPORT_SLOTS   4
+
+// One screen cell, as the player sees it
+typedef struct ExportCell {
+  uint8_t value;
+  uint8_t fg[3], bg[3];
+  uint8_t pad;
+} ExportCell_t;
+
+// One frame in the ring. Readers use it in place between ExportPeek(...)
+// and ExportValidate(...).
+typedef struct ExportSlot {
+  _Atomic uint64_t seq;  // Odd while the game writes the slot
+  uint64_t frame;
+  uint16_t rows, cols;
+  uint32_t pad;
+  ExportCell_t cells[];  // rows * cols, row by row
+} ExportSlot_t;
+
+typedef struct Export Export_t;
+
+bool ExportCreate(Export_t *exp, const char *name, unsigned short rows, unsigned short cols);
+
+bool ExportFits(const Export_t *exp, const VTerm_t *vt);
+
+void ExportPublish(Export_t *exp, const VTerm_t *vt);
+
+void ExportClose(Export_t *exp);
+
+bool ExportAttach(Export_t *exp, const char *name);
+
+bool ExportIsClosed(const Export_t *exp);
+
+const ExportSlot_t *ExportPeek(const Export_t *exp, uint64_t *seq, unsigned short *rows, unsigned short *cols);
+
+bool ExportValidate(const ExportSlot_t *slot, uint64_t seq);
+
+void ExportDetach(Export_t *exp);
+
+#ifdef EXPORT_INCLUDE_IMPL
+
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Shared memory layout: the header, then EXPORT_SLOTS slots of slot_size
+// bytes. The game writes frame n into slot n % EXPORT_SLOTS under a seqlock
+// and then publishes n + 1 in 'latest', so it never waits for a reader and
+// a reader only has to retry when the game laps it.
+#define EXPORT_MAGIC       "SNAKEFRM"
+#define EXPORT_HEADER_SIZE 64
+
+typedef struct ExportHeader {
+  char magic[8];
+  uint32_t version, slot_count;
+  uint64_t slot_size;         // Bytes per slot, with its ExportSlot_t header
+  uint32_t capacity;          // Cells per slot
+  _Atomic uint32_t closed;    // The game is gone
+  _Atomic uint64_t latest;    // Newest complete frame + 1, 0 before the first
+} ExportHeader_t;
+
+typedef struct Export {
+  ExportHeader_t *header;
+  size_t size;
+  uint64_t frame;             // Next frame to publish
+  char name[64];              // Set for the writer, which unlinks it
+} Export_t;
+
+static ExportSlot_t *ExportSlot(const Export_t *exp, uint64_t frame) {
+  uint8_t *slots = (uint8_t *)exp->header + EXPORT_HEADER_SIZE;
+  return (ExportSlot_t *)(slots + (frame % exp->header->slot_count) * exp->header->slot_size);
+}
+
+// Creates the shared memory object 'name' (e.g. "/snake") for frames of up
+// to rows x cols cells. It fails with errno EEXIST if the name is taken,
+// since truncating another game's frames would crash its readers.
+bool ExportCreate(Export_t *exp, const char *name, unsigned short rows, unsigned short cols) {
+  *exp = (Export_t) { 0 };
+  if (strlen(name) >= sizeof(exp->name)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+
+  size_t capacity = (size_t)rows * cols;
+  size_t slot_size = (sizeof(ExportSlot_t) + capacity * sizeof(ExportCell_t) + 63) & ~(size_t)63;
+  size_t size = EXPORT_HEADER_SIZE + EXPORT_SLOTS * slot_size;
+
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) return false;
+
+  if (ftruncate(fd, (off_t)size) != 0) {
+    close(fd);
+    shm_unlink(name);
+    return false;
+  }
+
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    shm_unlink(name);
+    return false;
+  }
+
+  exp->header = data;
+  exp->size = size;
+  strcpy(exp->name, name);
+
+  // ftruncate(...) zeroed it, so all sequences start even
+  memcpy(exp->header->magic, EXPORT_MAGIC, 8);
+  exp->header->version = EXPORT_VERSION;
+  exp->header->slot_count = EXPORT_SLOTS;
+  exp->header->slot_size = slot_size;
+  exp->header->capacity = (uint32_t)capacity;
+
+  return true;
+}
+
+// False if the slots are too small for the visible part of 'vt'
+bool ExportFits(const Export_t *exp, const VTerm_t *vt) {
+  return exp->header != NULL && (size_t)(vt->rows - 1) * (vt->cols - 1) <= exp->header->capacity;
+}
+
+// Copies the visible part of 'vt' into the next slot. Like the terminal,
+// it skips row 0 and col 0, which UpdateWindow(...) draws over.
+void ExportPublish(Export_t *exp, const VTerm_t *vt) {
+  if (exp->header == NULL || vt->rows < 2 || vt->cols < 2) return;
+
+  unsigned short rows = vt->rows - 1, cols = vt->cols - 1;
+  if ((size_t)rows * cols > exp->header->capacity) return;
+
+  ExportSlot_t *slot = ExportSlot(exp, exp->frame);
+  uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+  atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  slot->frame = exp->frame;
+  slot->rows = rows;
+  slot->cols = cols;
+
+  ExportCell_t *cell = slot->cells;
+  for (unsigned short i = 1; i < vt->rows; i++) {
+    for (unsigned short j = 1; j < vt->cols; j++, cell++) {
+      const Glyph_t *glyph = &vt->screen[i][j];
+      *cell = (ExportCell_t) {
+        .value = (uint8_t)glyph->value,
+        .fg = { glyph->fg_color.r, glyph->fg_color.g, glyph->fg_color.b },
+        .bg = { glyph->bg_color.r, glyph->bg_color.g, glyph->bg_color.b }
+      };
+    }
+  }
+
+  atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+  atomic_store_explicit(&exp->header->latest, ++exp->frame, memory_order_release);
+}
+
+// Unmaps the frames. The writer also marks them closed and removes the name.
+void ExportClose(Export_t *exp) {
+  if (exp->header == NULL) return;
+
+  if (exp->name[0] != '\0') {
+    atomic_store_explicit(&exp->header->closed, 1, memory_order_release);
+    shm_unlink(exp->name);
+  }
+
+  munmap(exp->header, exp->size);
+  *exp = (Export_t) { 0 };
+}
+
+// Maps the frames of a running game read-only
+bool ExportAttach(Export_t *exp, const char *name) {
+  *exp = (Export_t) { 0 };
+
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < EXPORT_HEADER_SIZE) {
+    close(fd);
+    return false;
+  }
+
+  void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return false;
+
+  exp->header = data;
+  exp->size = (size_t)st.st_size;
+
+  const ExportHeader_t *header = exp->header;
+  bool valid =
+    memcmp(header->magic, EXPORT_MAGIC, 8) == 0 &&
+    header->version == EXPORT_VERSION &&
+    header->slot_count > 0 &&
+    header->slot_size >= sizeof(ExportSlot_t) + (size_t)header->capacity * sizeof(ExportCell_t) &&
+    header->slot_size <= (exp->size - EXPORT_HEADER_SIZE) / header->slot_count;
+
+  if (!valid) {
+    ExportDetach(exp);
+    return false;
+  }
+
+  return true;
+}
+
+bool ExportIsClosed(const Export_t *exp) {
+  return atomic_load_explicit(&exp->header->closed, memory_order_acquire) != 0;
+}
+
+// The newest frame, or NULL if there is none or it is being rewritten. Read
+// it in place, then check with ExportValidate(...) that it wasn't torn.
+// The game may rewrite the slot meanwhile, so use the size in 'rows' and
+// 'cols', which fits the slot, rather than the one in it.
+const ExportSlot_t *ExportPeek(const Export_t *exp, uint64_t *seq, unsigned short *rows, unsigned short *cols) {
+  uint64_t latest = atomic_load_explicit(&exp->header->latest, memory_order_acquire);
+  if (latest == 0) return NULL;
+
+  const ExportSlot_t *slot = ExportSlot(exp, latest - 1);
+  *seq = atomic_load_explicit(&((ExportSlot_t *)slot)->seq, memory_order_acquire);
+  if (*seq & 1) return NULL;
+
+  // Read once, as the game may change them between two reads
+  *rows = ((const volatile ExportSlot_t *)slot)->rows;
+  *cols = ((const volatile ExportSlot_t *)slot)->cols;
+  if ((size_t)*rows * *cols > exp->header->capacity) return NULL;
+  return slot;
+}
+
+bool ExportValidate(const ExportSlot_t *slot, uint64_t seq) {
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit(&((ExportSlot_t *)slot)->seq, memory_order_relaxed) == seq;
+}
+
+void ExportDetach(Export_t *exp) {
+  if (exp->header != NULL)
+    munmap(exp->header, exp->size);
+  *exp = (Export_t) { 0 };
+}
+
+#undef EXPORT_INCLUDE_IMPL
+#endif // EXPORT_INCLUDE_IMPL
+
+#endif // EXPORT_LIBRARY
@@ -0,0 +1,450 @@
+#ifndef GAME_LIBRARY
+#define GAME_LIBRARY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// SCORE_TO_WIN can be overridden at compile time (e.g. for snake-batch runs)
+#ifndef SCORE_TO_WIN
+#define SCORE_TO_WIN  100
+#endif
+
+#define MAX_LIFES     3
+#define MAX_SNAKE_LEN (SCORE_TO_WIN + 1)
+
+// Upper bound of GameSave(...) output
+#define GAME_SAVE_MAX (30 + 4 * MAX_SNAKE_LEN)
+
+// Bit flags returned by GameStep(...)
+#define GAME_ATE_FOOD  (1u << 0)
+#define GAME_HIT_WALL  (1u << 1)
+#define GAME_HIT_SELF  (1u << 2)
+#define GAME_WON       (1u << 3)
+#define GAME_LOST      (1u << 4)
+
+typedef enum MoveDir MoveDir_t;
+
+typedef struct SnakePart SnakePart_t;
+
+typedef struct Food Food_t;
+
+typedef struct Game Game_t;
+
+void GameSeed(Game_t *game, uint64_t seed);
+
+int GameRandInt(Game_t *game, int min, int max);
+
+void GameInit(Game_t *game, unsigned short rows, unsigned short cols, uint64_t seed);
+
+void GameReset(Game_t *game, bool reset_best);
+
+void GameSpawnFood(Game_t *game);
+
+void GameGrowSnake(Game_t *game);
+
+void GameSetDirection(Game_t *game, MoveDir_t dir);
+
+void GameResize(Game_t *game, unsigned short rows, unsigned short cols);
+
+unsigned GameStep(Game_t *game);
+
+size_t GameSave(const Game_t *game, uint8_t *buff);
+
+bool GameLoad(Game_t *game, const uint8_t *buff, size_t size);
+
+#ifdef GAME_INCLUDE_IMPL
+
+typedef enum MoveDir { UP, DOWN, RIGHT, LEFT, IDLE } MoveDir_t;
+
+typedef struct SnakePart {
+  unsigned short row, col;
+  bool is_head;
+} SnakePart_t;
+
+typedef struct Food { unsigned short row, col; } Food_t;
+
+// The whole state of a single game. Nothing here is global, so any number
+// of games can be simulated at once (see snake_batch.c).
+typedef struct Game {
+  // Board size; the walls are drawn at rows 2 and rows - 1, cols 2 and cols - 2
+  unsigned short rows, cols;
+
+  SnakePart_t snake[MAX_SNAKE_LEN];
+  unsigned short snake_length;
+
+  MoveDir_t moving_dir, ex_moving_dir;
+
+  unsigned short score;
+  unsigned short best_score;
+  unsigned short lifes;
+
+  unsigned short self_intersection_index;
+
+  Food_t food;
+  // The food comes from somewhere else (e.g. world.h) and 'food' is unused
+  bool external_food;
+
+  // splitmix64 state, replaces the global rand()
+  uint64_t rng;
+} Game_t;
+
+void GameSeed(Game_t *game, uint64_t seed) {
+  game->rng = seed;
+}
+
+static uint64_t GameNextRandom(Game_t *game) {
+  uint64_t z = (game->rng += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+int GameRandInt(Game_t *game, int min, int max) {
+  return (int)(GameNextRandom(game) % (uint64_t)(max - min + 1)) + min;
+}
+
+void GameInit(Game_t *game, unsigned short rows, unsigned short cols, uint64_t seed) {
+  *game = (Game_t) { 0 };
+  game->rows = rows;
+  game->cols = cols;
+  game->snake[0].is_head = true;
+
+  GameSeed(game, seed);
+  GameReset(game, true);
+}
+
+void GameReset(Game_t *game, bool reset_best) {
+  game->score = 0;
+
+  if (reset_best == true)
+    game->best_score = 0;
+
+  game->snake_length = 1;
+  game->lifes = MAX_LIFES;
+
+  game->moving_dir = IDLE;
+  game->ex_moving_dir = IDLE;
+
+  game->snake[0].row = game->rows / 2;
+  game->snake[0].col = game->cols / 2;
+
+  GameSpawnFood(game);
+}
+
+void GameSpawnFood(Game_t *game) {
+  if (game->external_food) {
+    // Row 0 is outside the walls, so the snake never gets there
+    game->food = (Food_t) { 0 };
+    return;
+  }
+
+  game->food.row = (unsigned short)GameRandInt(game, 4, game->rows - 4);
+  game->food.col = (unsigned short)GameRandInt(game, 4, game->cols - 4);
+}
+
+void GameSetDirection(Game_t *game, MoveDir_t dir) {
+  game->ex_moving_dir = game->moving_dir;
+  game->moving_dir = dir;
+}
+
+void GameGrowSnake(Game_t *game) {
+  if (game->snake_length >= MAX_SNAKE_LEN)
+    return;
+
+  const SnakePart_t *tail = &game->snake[game->snake_length - 1];
+  unsigned short row = 0, col = 0;
+
+  switch (game->moving_dir) {
+    case UP:
+      row = tail->row + 1;
+      col = tail->col;
+      break;
+    case DOWN:
+      row = tail->row - 1;
+      col = tail->col;
+      break;
+    case RIGHT:
+      row = tail->row;
+      col = tail->col - 1;
+      break;
+    case LEFT:
+      row = tail->row;
+      col = tail->col + 1;
+      break;
+    default:
+      break;
+  }
+
+  game->snake[game->snake_length].row = row;
+  game->snake[game->snake_length].col = col;
+  game->snake[game->snake_length].is_head = false;
+  game->snake_length++;
+
+  game->score++;
+  if (game->best_score < game->score) game->best_score = game->score;
+}
+
+static void GameChopSnake(Game_t *game) {
+  game->snake_length -= (game->snake_length - game->self_intersection_index);
+  game->score = game->snake_length - 1;
+  --game->lifes;
+}
+
+static void GameUpdateSnakePosition(Game_t *game) {
+  short horizontal = 0, vertical = 0;
+  unsigned short ex_row, ex_col, buff_row, buff_col;
+
+  switch (game->moving_dir) {
+    case UP:
+      horizontal = -1;
+      break;
+    case DOWN:
+      horizontal =  1;
+      break;
+    case RIGHT:
+      vertical   =  1;
+      break;
+    case LEFT:
+      vertical   = -1;
+      break;
+    default:
+      break;
+  }
+
+  SnakePart_t *snake = game->snake;
+
+  ex_row = snake[0].row;
+  ex_col = snake[0].col;
+
+  snake[0].row += horizontal;
+  snake[0].col += vertical;
+
+  for (unsigned short i = 1; i < game->snake_length; i++) {
+    buff_row = snake[i].row;
+    buff_col = snake[i].col;
+
+    snake[i].row = ex_row;
+    snake[i].col = ex_col;
+
+    ex_row = buff_row;
+    ex_col = buff_col;
+  }
+}
+
+static unsigned short GameClamp(unsigned short value, unsigned short min, unsigned short max) {
+  return value < min ? min : value > max ? max : value;
+}
+
+static bool GameInside(const Game_t *game, int row, int col) {
+  return row >= 3 && row <= game->rows - 2 && col >= 3 && col <= game->cols - 3;
+}
+
+// Inside or on the walls, where a snake that just hit one or grew along one
+// can be
+static bool GameOnBoard(const Game_t *game, int row, int col) {
+  return row >= 2 && row <= game->rows - 1 && col >= 2 && col <= game->cols - 2;
+}
+
+static bool GameFoodOnSnake(const Game_t *game) {
+  for (unsigned short i = 0; i < game->snake_length; i++)
+    if (game->snake[i].row == game->food.row && game->snake[i].col == game->food.col) return true;
+  return false;
+}
+
+// Moves the walls to a new board size. A head outside them comes back in
+// with the whole body, which keeps its shape; the part of the body that is
+// still outside is cut off, with its points, so the score stays
+// snake_length - 1 (the best score keeps them). Food outside is pulled back
+// in, or respawned if that puts it under the snake.
+void GameResize(Game_t *game, unsigned short rows, unsigned short cols) {
+  game->rows = rows;
+  game->cols = cols;
+
+  SnakePart_t *snake = game->snake;
+  int drow = (int)GameClamp(snake[0].row, 3, rows - 2) - snake[0].row;
+  int dcol = (int)GameClamp(snake[0].col, 3, cols - 3) - snake[0].col;
+
+  unsigned short length = 1;
+  while (length < game->snake_length &&
+         GameInside(game, snake[length].row + drow, snake[length].col + dcol))
+    length++;
+  game->snake_length = length;
+  game->score = length - 1;
+
+  for (unsigned short i = 0; i < length; i++) {
+    snake[i].row = (unsigned short)(snake[i].row + drow);
+    snake[i].col = (unsigned short)(snake[i].col + dcol);
+  }
+
+  if (!game->external_food) {
+    game->food.row = GameClamp(game->food.row, 3, rows - 2);
+    game->food.col = GameClamp(game->food.col, 3, cols - 3);
+
+    for (int tries = 0; tries < 100 && GameFoodOnSnake(game); tries++)
+      GameSpawnFood(game);
+  }
+}
+
+static bool GameCheckWallCollision(const Game_t *game) {
+  return (
+    game->snake[0].row == 2 ||
+    game->snake[0].row == game->rows - 1 ||
+    game->snake[0].col == 2 ||
+    game->snake[0].col == game->cols - 2
+  );
+}
+
+static bool GameCheckFoodCollision(const Game_t *game) {
+  return (
+    !game->external_food &&
+    game->snake[0].row == game->food.row &&
+    game->snake[0].col == game->food.col
+  );
+}
+
+static bool GameCheckSelfCollision(Game_t *game) {
+  if (game->snake_length == 1) return false;
+
+  MoveDir_t dir = game->moving_dir, ex_dir = game->ex_moving_dir;
+
+  if ((dir == UP    && ex_dir == DOWN)  ||
+      (dir == DOWN  && ex_dir == UP)    ||
+      (dir == LEFT  && ex_dir == RIGHT) ||
+      (dir == RIGHT && ex_dir == LEFT)  )
+  {
+    game->self_intersection_index = 1;
+    return true;
+  }
+
+  const SnakePart_t *snake = game->snake;
+  for (unsigned short i = 1; i < game->snake_length; i++) {
+    if (snake[0].row == snake[i].row && snake[0].col == snake[i].col) {
+      game->self_intersection_index = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Advances the game by one tick and reports what happened as GAME_* flags.
+// The order of the checks is the same as it always was in GameScreenScene.
+unsigned GameStep(Game_t *game) {
+  unsigned events = 0;
+
+  GameUpdateSnakePosition(game);
+
+  if (GameCheckWallCollision(game)) {
+    events |= GAME_HIT_WALL | GAME_LOST;
+  }
+
+  if (GameCheckFoodCollision(game)) {
+    GameGrowSnake(game);
+    GameSpawnFood(game);
+    events |= GAME_ATE_FOOD;
+  }
+
+  if (GameCheckSelfCollision(game)) {
+    GameChopSnake(game);
+    events |= GAME_HIT_SELF;
+  }
+
+  if (game->score == SCORE_TO_WIN) events |= GAME_WON;
+  if (game->lifes == 0) events |= GAME_LOST;
+
+  return events;
+}
+
+static uint8_t *GamePut16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8);
+  return p + 2;
+}
+
+static const uint8_t *GameGet16(const uint8_t *p, uint16_t *v) {
+  *v = (uint16_t)(p[0] | p[1] << 8);
+  return p + 2;
+}
+
+// Writes a compact little-endian copy of the game state into 'buff', which
+// must hold GAME_SAVE_MAX bytes. Only the used part of the snake is stored.
+size_t GameSave(const Game_t *game, uint8_t *buff) {
+  uint8_t *p = buff;
+
+  p = GamePut16(p, game->rows);
+  p = GamePut16(p, game->cols);
+  p = GamePut16(p, game->snake_length);
+  p = GamePut16(p, game->score);
+  p = GamePut16(p, game->best_score);
+  p = GamePut16(p, game->lifes);
+  p = GamePut16(p, game->self_intersection_index);
+  p = GamePut16(p, game->food.row);
+  p = GamePut16(p, game->food.col);
+  *p++ = (uint8_t)game->moving_dir;
+  *p++ = (uint8_t)game->ex_moving_dir;
+  *p++ = (uint8_t)game->external_food;
+  for (int i = 0; i < 8; i++) *p++ = (uint8_t)(game->rng >> (8 * i));
+
+  for (unsigned short i = 0; i < game->snake_length; i++) {
+    p = GamePut16(p, game->snake[i].row);
+    p = GamePut16(p, game->snake[i].col);
+  }
+
+  return (size_t)(p - buff);
+}
+
+// The reverse of GameSave(...). Returns false, leaving 'game' untouched, if
+// the data is cut short or doesn't describe a valid game.
+bool GameLoad(Game_t *game, const uint8_t *buff, size_t size) {
+  const size_t fixed = 9 * 2 + 3 + 8;
+  if (size < fixed) return false;
+
+  Game_t loaded = { 0 };
+  const uint8_t *p = buff;
+
+  p = GameGet16(p, &loaded.rows);
+  p = GameGet16(p, &loaded.cols);
+  p = GameGet16(p, &loaded.snake_length);
+  p = GameGet16(p, &loaded.score);
+  p = GameGet16(p, &loaded.best_score);
+  p = GameGet16(p, &loaded.lifes);
+  p = GameGet16(p, &loaded.self_intersection_index);
+  p = GameGet16(p, &loaded.food.row);
+  p = GameGet16(p, &loaded.food.col);
+  uint8_t dir = *p++, ex_dir = *p++;
+  loaded.external_food = *p++ != 0;
+  for (int i = 0; i < 8; i++) loaded.rng |= (uint64_t)*p++ << (8 * i);
+
+  if (loaded.snake_length < 1 || loaded.snake_length > MAX_SNAKE_LEN ||
+      dir > IDLE || ex_dir > IDLE || loaded.lifes > MAX_LIFES ||
+      loaded.rows < 8 || loaded.cols < 8 ||
+      size < fixed + 4u * loaded.snake_length)
+    return false;
+
+  // Every point is one part of the snake, so GAME_WON comes before the
+  // snake outgrows MAX_SNAKE_LEN
+  if (loaded.score != loaded.snake_length - 1 || loaded.best_score < loaded.score)
+    return false;
+
+  loaded.moving_dir = (MoveDir_t)dir;
+  loaded.ex_moving_dir = (MoveDir_t)ex_dir;
+
+  for (unsigned short i = 0; i < loaded.snake_length; i++) {
+    p = GameGet16(p, &loaded.snake[i].row);
+    p = GameGet16(p, &loaded.snake[i].col);
+    if (!GameOnBoard(&loaded, loaded.snake[i].row, loaded.snake[i].col)) return false;
+  }
+  loaded.snake[0].is_head = true;
+
+  // External food is set by the caller every tick
+  if (!loaded.external_food && !GameInside(&loaded, loaded.food.row, loaded.food.col))
+    return false;
+
+  *game = loaded;
+  return true;
+}
+
+#undef GAME_INCLUDE_IMPL
+#endif // GAME_INCLUDE_IMPL
+
+#endif // GAME_LIBRARY
@@ -0,0 +1,311 @@
+#ifndef RECORD_LIBRARY
+#define RECORD_LIBRARY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+
+#define RECORD_VERSION           1
+#define RECORD_KEYFRAME_INTERVAL 256
+
+// One byte per tick: the direction the player (or the autopilot) chose in
+// this tick, plus a new game that was started before it
+#define RECORD_DIR_MASK    0x07  // 0 = none, 1 + MoveDir_t otherwise
+#define RECORD_RESET       0x10  // GameReset(game, false)
+#define RECORD_RESET_BEST  0x20  // GameReset(game, true)
+
+typedef struct Recorder Recorder_t;
+
+typedef struct Replay Replay_t;
+
+bool RecorderOpen(Recorder_t *rec, const char *path, const Game_t *game);
+
+void RecorderTick(Recorder_t *rec, const Game_t *game, uint8_t event);
+
+bool RecorderClose(Recorder_t *rec);
+
+bool ReplayOpen(Replay_t *replay, const char *path);
+
+void ReplayClose(Replay_t *replay);
+
+bool ReplayKeyframe(const Replay_t *replay, uint64_t k, Game_t *game, uint64_t *tick);
+
+bool ReplaySeek(const Replay_t *replay, Game_t *game, uint64_t tick);
+
+unsigned ReplayStep(const Replay_t *replay, Game_t *game, uint64_t tick);
+
+#ifdef RECORD_INCLUDE_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// File layout, all numbers little-endian:
+//
+//   header     RECORD_HEADER_SIZE bytes, see RecordWriteHeader(...)
+//   ticks      tick_count event bytes, tick t at offset RECORD_HEADER_SIZE + t
+//   keyframes  GameSave(...) snapshots of the state before their tick
+//   index      keyframe_count entries of { u64 tick, u64 offset, u64 size }
+//
+// Since the game is deterministic, the seed in the first keyframe and the
+// inputs are all it takes to play a game again. The file is read through
+// mmap, so seeking is a binary search in the index plus at most
+// RECORD_KEYFRAME_INTERVAL simulated ticks.
+#define RECORD_MAGIC       "SNAKEREC"
+#define RECORD_HEADER_SIZE 64
+#define RECORD_INDEX_ENTRY 24
+
+typedef struct Recorder {
+  int fd;
+  uint64_t tick_count;
+
+  uint8_t ticks[4096];
+  size_t ticks_used;
+
+  // Snapshots and index stay in memory until RecorderClose(...)
+  uint8_t *keyframes;
+  size_t keyframes_size, keyframes_capacity;
+  uint64_t *index;  // (tick, offset in keyframes, size) triples
+  size_t index_count, index_capacity;
+} Recorder_t;
+
+typedef struct Replay {
+  const uint8_t *data;
+  size_t size;
+
+  uint64_t tick_count;
+  const uint8_t *ticks;
+  const uint8_t *index;
+  uint64_t keyframe_count;
+} Replay_t;
+
+static void RecordPut64(uint8_t *p, uint64_t v) {
+  for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t RecordGet64(const uint8_t *p) {
+  uint64_t v = 0;
+  for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+  return v;
+}
+
+static bool RecordWriteAll(int fd, const void *buff, size_t size) {
+  const uint8_t *p = buff;
+  while (size > 0) {
+    ssize_t written = write(fd, p, size);
+    if (written <= 0) return false;
+    p += written;
+    size -= (size_t)written;
+  }
+  return true;
+}
+
+static bool RecordWriteHeader(int fd, uint64_t tick_count, uint64_t index_offset, uint64_t keyframe_count) {
+  uint8_t header[RECORD_HEADER_SIZE] = { 0 };
+  memcpy(header, RECORD_MAGIC, 8);
+  RecordPut64(header + 8,  RECORD_VERSION);
+  RecordPut64(header + 16, tick_count);
+  RecordPut64(header + 24, index_offset);
+  RecordPut64(header + 32, keyframe_count);
+
+  return pwrite(fd, header, sizeof(header), 0) == (ssize_t)sizeof(header);
+}
+
+static bool RecorderAddKeyframe(Recorder_t *rec, const Game_t *game) {
+  if (rec->keyframes_capacity - rec->keyframes_size < GAME_SAVE_MAX) {
+    size_t capacity = rec->keyframes_capacity * 2 + GAME_SAVE_MAX * 16;
+    uint8_t *keyframes = realloc(rec->keyframes, capacity);
+    if (keyframes == NULL) return false;
+    rec->keyframes = keyframes;
+    rec->keyframes_capacity = capacity;
+  }
+
+  if (rec->index_count == rec->index_capacity) {
+    size_t capacity = rec->index_capacity * 2 + 64;
+    uint64_t *index = realloc(rec->index, capacity * 3 * sizeof(uint64_t));
+    if (index == NULL) return false;
+    rec->index = index;
+    rec->index_capacity = capacity;
+  }
+
+  size_t size = GameSave(game, rec->keyframes + rec->keyframes_size);
+  uint64_t *entry = rec->index + rec->index_count * 3;
+  entry[0] = rec->tick_count;
+  entry[1] = rec->keyframes_size;
+  entry[2] = size;
+
+  rec->keyframes_size += size;
+  rec->index_count++;
+  return true;
+}
+
+static bool RecorderFlushTicks(Recorder_t *rec) {
+  bool ok = RecordWriteAll(rec->fd, rec->ticks, rec->ticks_used);
+  rec->ticks_used = 0;
+  return ok;
+}
+
+bool RecorderOpen(Recorder_t *rec, const char *path, const Game_t *game) {
+  *rec = (Recorder_t) { 0 };
+
+  rec->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (rec->fd < 0) return false;
+
+  // Placeholder until RecorderClose(...) knows the counts
+  uint8_t header[RECORD_HEADER_SIZE] = { 0 };
+  if (!RecordWriteAll(rec->fd, header, sizeof(header)) || !RecorderAddKeyframe(rec, game)) {
+    close(rec->fd);
+    rec->fd = -1;
+    return false;
+  }
+
+  return true;
+}
+
+// Call once per tick, after the tick is done. 'game' is the state the next
+// tick starts from.
+void RecorderTick(Recorder_t *rec, const Game_t *game, uint8_t event) {
+  if (rec->fd < 0) return;
+
+  rec->ticks[rec->ticks_used++] = event;
+  rec->tick_count++;
+
+  if (rec->ticks_used == sizeof(rec->ticks))
+    RecorderFlushTicks(rec);
+
+  if (rec->tick_count % RECORD_KEYFRAME_INTERVAL == 0)
+    RecorderAddKeyframe(rec, game);
+}
+
+bool RecorderClose(Recorder_t *rec) {
+  if (rec->fd < 0) return false;
+
+  bool ok = RecorderFlushTicks(rec);
+
+  uint64_t keyframes_offset = RECORD_HEADER_SIZE + rec->tick_count;
+  uint64_t index_offset = keyframes_offset + rec->keyframes_size;
+
+  ok = ok && RecordWriteAll(rec->fd, rec->keyframes, rec->keyframes_size);
+
+  for (size_t i = 0; ok && i < rec->index_count; i++) {
+    uint8_t entry[RECORD_INDEX_ENTRY];
+    RecordPut64(entry,      rec->index[i * 3]);
+    RecordPut64(entry + 8,  keyframes_offset + rec->index[i * 3 + 1]);
+    RecordPut64(entry + 16, rec->index[i * 3 + 2]);
+    ok = RecordWriteAll(rec->fd, entry, sizeof(entry));
+  }
+
+  ok = ok && RecordWriteHeader(rec->fd, rec->tick_count, index_offset, rec->index_count);
+  ok = close(rec->fd) == 0 && ok;
+  rec->fd = -1;
+
+  free(rec->keyframes); rec->keyframes = NULL;
+  free(rec->index);     rec->index = NULL;
+  return ok;
+}
+
+bool ReplayOpen(Replay_t *replay, const char *path) {
+  *replay = (Replay_t) { 0 };
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < RECORD_HEADER_SIZE) {
+    close(fd);
+    return false;
+  }
+
+  void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return false;
+
+  replay->data = data;
+  replay->size = (size_t)st.st_size;
+
+  const uint8_t *header = replay->data;
+  uint64_t tick_count = RecordGet64(header + 16);
+  uint64_t index_offset = RecordGet64(header + 24);
+  uint64_t keyframe_count = RecordGet64(header + 32);
+
+  bool valid =
+    memcmp(header, RECORD_MAGIC, 8) == 0 &&
+    RecordGet64(header + 8) == RECORD_VERSION &&
+    keyframe_count > 0 &&
+    tick_count <= replay->size - RECORD_HEADER_SIZE &&
+    index_offset <= replay->size &&
+    keyframe_count <= (replay->size - index_offset) / RECORD_INDEX_ENTRY;
+
+  if (!valid) {
+    ReplayClose(replay);
+    return false;
+  }
+
+  replay->tick_count = tick_count;
+  replay->ticks = replay->data + RECORD_HEADER_SIZE;
+  replay->index = replay->data + index_offset;
+  replay->keyframe_count = keyframe_count;
+
+  return true;
+}
+
+void ReplayClose(Replay_t *replay) {
+  if (replay->data != NULL)
+    munmap((void *)replay->data, replay->size);
+  *replay = (Replay_t) { 0 };
+}
+
+bool ReplayKeyframe(const Replay_t *replay, uint64_t k, Game_t *game, uint64_t *tick) {
+  const uint8_t *entry = replay->index + k * RECORD_INDEX_ENTRY;
+  uint64_t offset = RecordGet64(entry + 8), size = RecordGet64(entry + 16);
+
+  if (offset > replay->size || size > replay->size - offset) return false;
+
+  *tick = RecordGet64(entry);
+  return GameLoad(game, replay->data + offset, (size_t)size);
+}
+
+// Applies the input of 'tick' and advances the game by it
+unsigned ReplayStep(const Replay_t *replay, Game_t *game, uint64_t tick) {
+  uint8_t event = replay->ticks[tick];
+
+  if (event & RECORD_RESET_BEST) GameReset(game, true);
+  else if (event & RECORD_RESET) GameReset(game, false);
+
+  if (event & RECORD_DIR_MASK)
+    GameSetDirection(game, (MoveDir_t)((event & RECORD_DIR_MASK) - 1));
+
+  return GameStep(game);
+}
+
+// Puts 'game' into the state right before 'tick'
+bool ReplaySeek(const Replay_t *replay, Game_t *game, uint64_t tick) {
+  if (tick > replay->tick_count) return false;
+
+  // Last keyframe at or before 'tick'
+  uint64_t lo = 0, hi = replay->keyframe_count;
+  while (hi - lo > 1) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    if (RecordGet64(replay->index + mid * RECORD_INDEX_ENTRY) <= tick) lo = mid;
+    else hi = mid;
+  }
+
+  uint64_t at;
+  if (!ReplayKeyframe(replay, lo, game, &at) || at > tick) return false;
+
+  for (; at < tick; at++)
+    ReplayStep(replay, game, at);
+
+  return true;
+}
+
+#undef RECORD_INCLUDE_IMPL
+#endif // RECORD_INCLUDE_IMPL
+
+#endif // RECORD_LIBRARY
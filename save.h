@@ -0,0 +1,222 @@
+#ifndef SAVE_LIBRARY
+#define SAVE_LIBRARY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+
+#define SAVE_VERSION 1
+#define SCORES_MAX   10
+
+typedef struct HighScore HighScore_t;
+
+typedef struct ScoreTable ScoreTable_t;
+
+bool SaveWrite(const char *path, const Game_t *game);
+
+bool SaveRead(const char *path, Game_t *game);
+
+bool ScoresRead(const char *path, ScoreTable_t *table);
+
+int ScoresInsert(ScoreTable_t *table, unsigned short score, uint64_t when);
+
+bool ScoresWrite(const char *path, const ScoreTable_t *table);
+
+#ifdef SAVE_INCLUDE_IMPL
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// Snapshot file, all numbers little-endian:
+//
+//   magic "SNAKESAV", u32 version, u32 size, u64 FNV-1a checksum of the state
+//   state  'size' bytes of GameSave(...)
+//
+// High score file:
+//
+//   magic "SNAKEHIS", u32 version, u32 count
+//   count entries of { u16 score, u16 zero, u32 zero, u64 unix time }
+//
+// Both are small enough to be read with a single read(...), and are written
+// to a temporary file that is renamed over the old one, so a crash leaves
+// either the old or the new file, never half of one.
+#define SAVE_MAGIC        "SNAKESAV"
+#define SAVE_HEADER_SIZE  24
+#define SCORES_MAGIC      "SNAKEHIS"
+#define SCORES_HEADER     16
+#define SCORES_ENTRY      16
+
+typedef struct HighScore {
+  unsigned short score;
+  uint64_t when;
+} HighScore_t;
+
+typedef struct ScoreTable {
+  unsigned count;
+  HighScore_t entries[SCORES_MAX];  // Best first
+} ScoreTable_t;
+
+static void SavePut32(uint8_t *p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void SavePut64(uint8_t *p, uint64_t v) {
+  for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t SaveGet32(const uint8_t *p) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+  return v;
+}
+
+static uint64_t SaveGet64(const uint8_t *p) {
+  uint64_t v = 0;
+  for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+  return v;
+}
+
+static uint64_t SaveChecksum(const uint8_t *data, size_t size) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+// Writes 'path' through 'path'.tmp and rename(...)
+static bool SaveAtomically(const char *path, const uint8_t *data, size_t size) {
+  char tmp[4096];
+  if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return false;
+
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+
+  bool ok = true;
+  while (ok && size > 0) {
+    ssize_t written = write(fd, data, size);
+    ok = written > 0;
+    if (ok) {
+      data += written;
+      size -= (size_t)written;
+    }
+  }
+
+  ok = ok && fsync(fd) == 0;
+  ok = close(fd) == 0 && ok;
+  ok = ok && rename(tmp, path) == 0;
+
+  if (!ok) unlink(tmp);
+  return ok;
+}
+
+// Reads all of a small file with one read(...). Returns the size, or 0 if
+// it is missing, empty or bigger than 'capacity'.
+static size_t SaveReadFile(const char *path, uint8_t *buff, size_t capacity) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return 0;
+
+  struct stat st = { 0 };
+  ssize_t got = 0;
+  if (fstat(fd, &st) == 0 && st.st_size > 0 && (size_t)st.st_size <= capacity)
+    got = read(fd, buff, (size_t)st.st_size);
+  close(fd);
+  return got == st.st_size ? (size_t)got : 0;
+}
+
+bool SaveWrite(const char *path, const Game_t *game) {
+  uint8_t buff[SAVE_HEADER_SIZE + GAME_SAVE_MAX];
+  size_t size = GameSave(game, buff + SAVE_HEADER_SIZE);
+
+  memcpy(buff, SAVE_MAGIC, 8);
+  SavePut32(buff + 8, SAVE_VERSION);
+  SavePut32(buff + 12, (uint32_t)size);
+  SavePut64(buff + 16, SaveChecksum(buff + SAVE_HEADER_SIZE, size));
+
+  return SaveAtomically(path, buff, SAVE_HEADER_SIZE + size);
+}
+
+// Loads the snapshot into 'game', which is left alone if it's missing,
+// from another version or damaged
+bool SaveRead(const char *path, Game_t *game) {
+  uint8_t buff[SAVE_HEADER_SIZE + GAME_SAVE_MAX];
+  size_t got = SaveReadFile(path, buff, sizeof(buff));
+  if (got < SAVE_HEADER_SIZE) return false;
+
+  uint32_t size = SaveGet32(buff + 12);
+  if (memcmp(buff, SAVE_MAGIC, 8) != 0 ||
+      SaveGet32(buff + 8) != SAVE_VERSION ||
+      size != got - SAVE_HEADER_SIZE ||
+      SaveGet64(buff + 16) != SaveChecksum(buff + SAVE_HEADER_SIZE, size))
+    return false;
+
+  return GameLoad(game, buff + SAVE_HEADER_SIZE, size);
+}
+
+// A missing file is an empty table
+bool ScoresRead(const char *path, ScoreTable_t *table) {
+  *table = (ScoreTable_t) { 0 };
+
+  uint8_t buff[SCORES_HEADER + SCORES_MAX * SCORES_ENTRY];
+  size_t got = SaveReadFile(path, buff, sizeof(buff));
+  if (got == 0) return access(path, F_OK) != 0;
+
+  uint32_t count = SaveGet32(buff + 12);
+  if (got < SCORES_HEADER ||
+      memcmp(buff, SCORES_MAGIC, 8) != 0 ||
+      SaveGet32(buff + 8) != SAVE_VERSION ||
+      count > SCORES_MAX || got != SCORES_HEADER + count * SCORES_ENTRY)
+    return false;
+
+  for (uint32_t i = 0; i < count; i++) {
+    const uint8_t *entry = buff + SCORES_HEADER + i * SCORES_ENTRY;
+    table->entries[i].score = (unsigned short)(entry[0] | entry[1] << 8);
+    table->entries[i].when = SaveGet64(entry + 8);
+  }
+  table->count = count;
+  return true;
+}
+
+// Returns the rank (0 is the best) the score got, -1 if it didn't make it.
+// Ties go below the older scores.
+int ScoresInsert(ScoreTable_t *table, unsigned short score, uint64_t when) {
+  unsigned rank = 0;
+  while (rank < table->count && table->entries[rank].score >= score) rank++;
+  if (rank == SCORES_MAX) return -1;
+
+  unsigned last = table->count < SCORES_MAX ? table->count : SCORES_MAX - 1;
+  memmove(&table->entries[rank + 1], &table->entries[rank], (last - rank) * sizeof(HighScore_t));
+
+  table->entries[rank] = (HighScore_t) { score, when };
+  if (table->count < SCORES_MAX) table->count++;
+  return (int)rank;
+}
+
+bool ScoresWrite(const char *path, const ScoreTable_t *table) {
+  uint8_t buff[SCORES_HEADER + SCORES_MAX * SCORES_ENTRY] = { 0 };
+
+  memcpy(buff, SCORES_MAGIC, 8);
+  SavePut32(buff + 8, SAVE_VERSION);
+  SavePut32(buff + 12, table->count);
+
+  for (unsigned i = 0; i < table->count; i++) {
+    uint8_t *entry = buff + SCORES_HEADER + i * SCORES_ENTRY;
+    entry[0] = (uint8_t)table->entries[i].score;
+    entry[1] = (uint8_t)(table->entries[i].score >> 8);
+    SavePut64(entry + 8, table->entries[i].when);
+  }
+
+  return SaveAtomically(path, buff, SCORES_HEADER + table->count * SCORES_ENTRY);
+}
+
+#undef SAVE_INCLUDE_IMPL
+#endif // SAVE_INCLUDE_IMPL
+
+#endif // SAVE_LIBRARY
@@ -1,190 +1,255 @@
 #include <stdbool.h>
+#include <errno.h>
 #include <time.h>
 
 #include <signal.h>
+#include <sys/stat.h>
 
 #define TGUI_INCLUDE_IMPL
 #include "tgui.h"
 
+#define GAME_INCLUDE_IMPL
+#include "game.h"
+
+#define BOT_INCLUDE_IMPL
+#include "bot.h"
+
+#define ARENA_INCLUDE_IMPL
+#include "arena.h"
+
+#define WORLD_INCLUDE_IMPL
+#include "world.h"
+
+#define RECORD_INCLUDE_IMPL
+#include "record.h"
+
+#define STATS_INCLUDE_IMPL
+#include "stats.h"
+
+#define EXPORT_INCLUDE_IMPL
+#include "export.h"
+
+#define SPECTATE_INCLUDE_IMPL
+#include "spectate.h"
+
+#define SAVE_INCLUDE_IMPL
+#include "save.h"
+
 // In the Windows terminal, the colors seem to be reversed
 #define RED    RGB(245, 0,  0)   // RGB(10,  255, 255)
 #define GREEN  RGB(0,  245, 0)   // RGB(255, 10,  255)
 #define WHITE  RGB(25, 25, 25)   // RGB(230, 230, 230)
 #define BG     RGB(0,  64, 64)   // RGB(255, 191, 191)
 
-#define MAX_LIFES     3
-#define MAX_SNAKE_LEN 101
-#define SCORE_TO_WIN  100
+static Game_t game;
+
+static Bot_t bot;
+static bool autopilot = false;
+
+static Arena_t arena;
+static unsigned arena_snakes = 0;
 
-static struct SnakePart {
-  unsigned short row, col;
-  bool is_head;
-} snake[MAX_SNAKE_LEN] = {0};
+static World_t world;
+static bool world_mode = false;
+static unsigned short world_rows = 0, world_cols = 0;
 
-static unsigned short snake_length = 1;
+static Recorder_t recorder = { .fd = -1 };
+static const char *record_path = NULL;
+static uint8_t pending_event = 0;  // RECORD_RESET* flags for the next tick
 
-static enum MoveDir { UP, DOWN, RIGHT, LEFT, IDLE } moving_dir = IDLE, ex_moving_dir = IDLE;
+static Replay_t replay;
+static const char *replay_path = NULL;
+static bool headless = false;
+static bool show_scores = false;
 
-static unsigned short score = 0;
-static unsigned short best_score = 0;
-static unsigned short lifes = MAX_LIFES;
+static FrameStats_t stats;
+static bool stats_overlay = false;
+static const char *stats_path = NULL;
 
-static unsigned short self_intersection_index = 0;
+// Input-to-display latency of the keys in game (--latency)
+enum LatencyPart {
+  LATENCY_WAIT,   // Key arrived until the tick decoded it
+  LATENCY_FRAME,  // Decoded until UpdateWindow(...) wrote the frame
+  LATENCY_DRAIN,  // Written until the terminal read all of it
+  LATENCY_TOTAL,
+  LATENCY_PART_COUNT
+};
+
+static const char *latency_names[LATENCY_PART_COUNT] = { "wait", "frame", "drain", "total" };
+
+static bool latency_mode = false;
+static StatsHistogram_t latency[LATENCY_PART_COUNT];
+static uint64_t key_arrived = 0; // When stdin got readable, 0 if it didn't yet
+
+static Export_t frame_export;
+static const char *export_name = NULL;
+
+static SpectateServer_t spectate = { .listen_fd = -1, .epoll_fd = -1 };
+static const char *spectate_path = NULL;
+
+// The classic game is saved on pause and on exit and resumed on the next
+// start; finished games go into the high scores (--no-save turns it off)
+static bool saving = true;
+static bool game_resumable = false;  // A game is in progress
+static char save_path[4096], scores_path[4096];
+static ScoreTable_t scores;
+
+static volatile sig_atomic_t window_resized = 0;
 
 static bool game_should_quit = false;
 
 static enum Scene { 
   START_MENU,  PAUSE_MENU,
   GAME_SCREEN, HELP_SCREEN,
-  WIN_MESSAGE, LOSE_MESSAGE
+  WIN_MESSAGE, LOSE_MESSAGE,
+  ARENA_SCREEN
 } scene = START_MENU, ex_scene = START_MENU;
 
-static struct Food { unsigned short row, col; } food = {0};
+// Puts the game that just ended into the high scores
+static void RecordScore(void) {
+  if (!saving || game.score == 0) return;
 
-static void GrowSnake(void) {
-  if (snake_length >= MAX_SNAKE_LEN)
-    return;
+  // Without a writable state dir the scores last until the game exits
+  if (ScoresInsert(&scores, game.score, (uint64_t)time(NULL)) >= 0)
+    ScoresWrite(scores_path, &scores);
+}
 
-  unsigned short row = 0, col = 0;
+// Keeps the game in progress for the next start, or forgets the last one
+static void SaveGame(void) {
+  if (!saving) return;
 
-  switch (moving_dir) {
-    case UP:
-      row = snake[snake_length-1].row + 1;
-      col = snake[snake_length-1].col;
-      break;
-    case DOWN:
-      row = snake[snake_length-1].row - 1;
-      col = snake[snake_length-1].col;
-      break;
-    case RIGHT:
-      row = snake[snake_length-1].row;
-      col = snake[snake_length-1].col - 1;
-      break;
-    case LEFT:
-      row = snake[snake_length-1].row;
-      col = snake[snake_length-1].col + 1;
-      break;
-    default:
-      break;
-  }
+  if (game_resumable)
+    SaveWrite(save_path, &game);
+  else
+    unlink(save_path);
+}
 
-  snake[snake_length].row = row;
-  snake[snake_length].col = col;
-  snake[snake_length].is_head = false;
-  snake_length++;
+static void NewGame(bool reset_best) {
+  RecordScore();
+  game_resumable = false;
 
-  score++;
-  if (best_score < score) best_score = score;
+  GameReset(&game, reset_best);
+  BotForgetPath(&bot);
+  pending_event |= reset_best ? RECORD_RESET_BEST : RECORD_RESET;
 }
 
-static void ChopSnake(void) {
-  snake_length -= (snake_length - self_intersection_index);
-  score = snake_length - 1;
-  --lifes;
-}
+// Shows the composed frame on the terminal and to everyone watching
+static void PresentFrame(const VTerm_t *vt) {
+  ExportPublish(&frame_export, vt);
 
-static void UpdateSnakePosition(void) {
-  short horizontal = 0, vertical = 0;
-  unsigned short ex_row, ex_col, buff_row, buff_col;
+  // UpdateWindow(...), keeping the bytes for the spectators
+  size_t size;
+  const char *diff = EncodeWindow(vt, &size);
+  WriteWindow(diff, size);
+  SpectateFrame(&spectate, vt, diff, size);
+}
 
-  switch (moving_dir) {
-    case UP:
-      horizontal = -1;
-      break;
-    case DOWN:
-      horizontal =  1;
-      break;
-    case RIGHT:
-      vertical   =  1;
-      break;
-    case LEFT:
-      vertical   = -1;
-      break;
-    default:
-      break;
-  }
+// This is the size of the biggest text box. If the windows is smaller
+// then the specified size, the game will crush on opening the Help menu.
+// So until it is bigger, this shows a message (any key quits) and keeps
+// the VTerm at the window size. Returns the new VTerm size.
+static void WaitForBigWindow(VTerm_t *vt, unsigned short *wrs, unsigned short *wcs) {
+  static const char *text[] = {
+    "       The window size is too small.        ",
+    "Window must be at least 25x42 (rows X cols)."
+  };
 
-  ex_row = snake[0].row;
-  ex_col = snake[0].col;
+  unsigned short text_width = strlen(text[0]);
+  unsigned short text_height = sizeof(text) / sizeof(text[0]);
 
-  snake[0].row += horizontal;
-  snake[0].col += vertical;
+  // Cleared before reading the size, so a resize in between isn't missed
+  window_resized = 0;
+  GetWindowSize(wrs, wcs);
+  ++*wrs, ++*wcs;
 
-  for (unsigned short i = 1; i < snake_length; i++) {
-    buff_row = snake[i].row;
-    buff_col = snake[i].col;
+  while (*wrs < 25 || *wcs < 42) {
+    VTermResize(vt, *wrs, *wcs);
+    VTermReset(vt, ' ', BG, BG);
 
-    snake[i].row = ex_row;
-    snake[i].col = ex_col;
+    if (vt->rows >= text_height + 4 && vt->cols >= text_width + 4) {
+      // Row (r1) and col (c1) of the top left corner
+      unsigned short r1 = (vt->rows - text_height) / 2;
+      unsigned short c1 = (vt->cols - text_width)  / 2;
 
-    ex_row = buff_row;
-    ex_col = buff_col;
-  }
-}
+      // Row (r2) and col (c2) of the bottom right corner
+      unsigned short r2 = (vt->rows + text_height) / 2 + 1;
+      unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
+      SetRect(vt, WHITE, BG, r1, c1, r2, c2);
+      SetMultilineText(vt, text, text_height, WHITE, BG, r1 + 1, c1 + 1);
+    } else if (vt->rows >= 2 && vt->cols >= 2) {
+      char buff[16];
+      snprintf(buff, sizeof(buff) < vt->cols ? sizeof(buff) : vt->cols, "Too small");
+      SetText(vt, buff, WHITE, BG, 1, 1);
+    }
 
-static int RandInt(int min, int max) {
-  return (rand() % (max - min + 1)) + min;
-}
+    InvalidateWindow();
+    PresentFrame(vt);
 
-static void SpawnFood(VTerm_t *vt) {
-  food.row = (short)RandInt(4, vt->rows - 4);
-  food.col = (short)RandInt(4, vt->cols - 4);
-}
+    while (!window_resized) {
+      if (GetKeyPressed() != KEY_NONE) {
+        // Clean up
+        VTermDeinit(vt);
+        ResetWindow();
+        exit(EXIT_FAILURE);
+      }
+      DelayMs(10);
+    }
 
-static bool CheckWallCollision(VTerm_t *vt) {
-  return (
-    snake[0].row == 2 ||
-    snake[0].row == vt->rows - 1 ||
-    snake[0].col == 2 ||
-    snake[0].col == vt->cols - 2
-  );
+    window_resized = 0;
+    GetWindowSize(wrs, wcs);
+    ++*wrs, ++*wcs;
+  }
 }
 
-static bool CheckFoodCollision(void) {
-  return (
-    snake[0].row == food.row &&
-    snake[0].col == food.col
-  );
+// ExportCreate(...) failed with 'error'. A name that is taken is most
+// likely another game, or one that crashed and left its frames behind.
+static void ExportCreateFailed(int error) {
+  ResetWindow();
+  if (error == EEXIST)
+    fprintf(stderr, "  \033[31mError:\033[0m The shared memory '%s' is used by another game; if none is running, remove /dev/shm/%s\n",
+      export_name, export_name + (export_name[0] == '/'));
+  else
+    fprintf(stderr, "  \033[31mError:\033[0m Couldn't create the shared memory '%s'\n", export_name);
+  exit(EXIT_FAILURE);
 }
 
-static bool CheckSelfCollision(void) {
-  if (snake_length == 1) return false;
-
-  if ((moving_dir == UP    && ex_moving_dir == DOWN)  ||
-      (moving_dir == DOWN  && ex_moving_dir == UP)    ||
-      (moving_dir == LEFT  && ex_moving_dir == RIGHT) ||
-      (moving_dir == RIGHT && ex_moving_dir == LEFT)  )
-  {
-    self_intersection_index = 1;
-    return true;
+// Applies a pending SIGWINCH: the VTerm follows the window and the classic
+// board follows the VTerm. Boards that can't change (arena, replays and
+// recordings) keep their VTerm size. Returns true if the caller has to
+// compose its frame again; the next frame is redrawn in full, once.
+static bool HandleResize(VTerm_t *vt) {
+  if (!window_resized) return false;
+  window_resized = 0;
+
+  bool board_follows = !world_mode && arena_snakes == 0 && replay_path == NULL && record_path == NULL;
+  unsigned short rows = vt->rows, cols = vt->cols, wrs, wcs;
+
+  WaitForBigWindow(vt, &wrs, &wcs);
+  if (board_follows || world_mode) {
+    rows = wrs;
+    cols = wcs;
   }
-
-  for (unsigned short i = 1; i < snake_length; i++) {
-    if (snake[0].row == snake[i].row && snake[0].col == snake[i].col) {
-      self_intersection_index = i;
-      return true;
+  VTermResize(vt, rows, cols);
+
+  if (board_follows && (game.rows != rows || game.cols != cols)) {
+    GameResize(&game, rows, cols);
+    BotDeinit(&bot);
+    if (!BotInit(&bot, rows, cols)) {
+      ResetWindow();
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for the autopilot in \033[33mHandleResize(...)\033[0m\n");
+      exit(EXIT_FAILURE);
     }
   }
 
-  return false;
-}
-
-static void ResetGame(VTerm_t *vt, bool reset_best) {
-  score = 0;
-
-  if (reset_best == true)
-    best_score = 0;
-
-  snake_length = 1;
-  lifes = MAX_LIFES;
-
-  moving_dir = IDLE;
-  ex_moving_dir = IDLE;
-
-  snake[0].row = vt->rows / 2;
-  snake[0].col = vt->cols / 2;
+  // Viewers of the shared memory attach again to a bigger one
+  if (export_name != NULL && !ExportFits(&frame_export, vt)) {
+    ExportClose(&frame_export);
+    if (!ExportCreate(&frame_export, export_name, rows - 1, cols - 1))
+      ExportCreateFailed(errno);
+  }
 
-  SpawnFood(vt);
+  InvalidateWindow();
+  return true;
 }
 
 static void StartMenuScene(VTerm_t *vt) {
@@ -201,18 +266,20 @@ static void StartMenuScene(VTerm_t *vt) {
   unsigned short text_width  = strlen(text[0]) ;
   unsigned short text_height = sizeof(text) / sizeof(text[0]);
 
-  // Row (r1) and col (c1) of the top left corner
-  unsigned short r1 = (vt->rows - text_height) / 2;
-  unsigned short c1 = (vt->cols - text_width)  / 2;
-
-  // Row (r2) and col (c2) of the bottom right corner
-  unsigned short r2 = (vt->rows + text_height) / 2 + 1;
-  unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
-
   short cursor = 0;
 
   Key_t k = GetKeyPressed();
   while (k != KEY_ENTER) {
+      HandleResize(vt);
+
+      // Row (r1) and col (c1) of the top left corner
+      unsigned short r1 = (vt->rows - text_height) / 2;
+      unsigned short c1 = (vt->cols - text_width)  / 2;
+
+      // Row (r2) and col (c2) of the bottom right corner
+      unsigned short r2 = (vt->rows + text_height) / 2 + 1;
+      unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
+
       k = GetKeyPressed();
       switch (k) {
         case KEY_W:
@@ -238,7 +305,7 @@ static void StartMenuScene(VTerm_t *vt) {
       SetGlyph(vt, '>', WHITE, BG, r1 + cursor + 1, c1 + 4);
       SetGlyph(vt, '<', WHITE, BG, r1 + cursor + 1, c2 - 4);
 
-      UpdateWindow(vt);
+      PresentFrame(vt);
       DelayMs(10);
   }
 
@@ -270,18 +337,20 @@ static void PauseMenuScene(VTerm_t *vt) {
   unsigned short text_width  = strlen(text[0]);
   unsigned short text_height = sizeof(text) / sizeof(text[0]);
 
-  // Row (r1) and col (c1) of the top left corner
-  unsigned short r1 = (vt->rows - text_height) / 2;
-  unsigned short c1 = (vt->cols - text_width)  / 2;
-
-  // Row (r2) and col (c2) of the bottom right corner
-  unsigned short r2 = (vt->rows + text_height) / 2 + 1;
-  unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
-
   short cursor = 0;
 
   Key_t k = GetKeyPressed();
   while (k != KEY_ENTER) {
+      HandleResize(vt);
+
+      // Row (r1) and col (c1) of the top left corner
+      unsigned short r1 = (vt->rows - text_height) / 2;
+      unsigned short c1 = (vt->cols - text_width)  / 2;
+
+      // Row (r2) and col (c2) of the bottom right corner
+      unsigned short r2 = (vt->rows + text_height) / 2 + 1;
+      unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
+
       k = GetKeyPressed();
       switch (k) {
         case KEY_W:
@@ -307,7 +376,7 @@ static void PauseMenuScene(VTerm_t *vt) {
       SetGlyph(vt, '>', WHITE, BG, r1 + cursor + 1, c1 + 4);
       SetGlyph(vt, '<', WHITE, BG, r1 + cursor + 1, c2 - 4);
       
-      UpdateWindow(vt);
+      PresentFrame(vt);
       DelayMs(10);
   }
   
@@ -315,7 +384,7 @@ static void PauseMenuScene(VTerm_t *vt) {
     case 0: scene = GAME_SCREEN;
       break;
     case 2: scene = GAME_SCREEN;
-      ResetGame(vt, true);      
+      NewGame(true);
       break;
     case 4: scene = HELP_SCREEN;
       break;
@@ -326,90 +395,314 @@ static void PauseMenuScene(VTerm_t *vt) {
   }
 }
 
+static void DrawBoard(VTerm_t *vt) {
+  VTermReset(vt, ' ', BG, BG);
+
+  // Borders
+  SetRect(vt, WHITE, BG, 2, 2, vt->rows - 1, vt->cols - 2);
+
+  if (autopilot)
+    SetText(vt, " AUTOPILOT ", WHITE, BG, 2, 4);
+
+  // Score
+  char buff[31];
+  sprintf(buff, "Score: %d Best score: %d", game.score, game.best_score);
+  SetText(vt, buff, WHITE, BG, 3, 4);
+
+  // Lifes
+  sprintf(buff, "Lifes: ");
+  for (unsigned short i = 0; i < game.lifes; i++) {
+    strcat(buff, "@ ");
+  }
+  SetText(vt, buff, WHITE, BG, 3, vt->cols - 16);
+
+  // Food
+  SetGlyph(vt, '*', RED, BG, game.food.row, game.food.col);
+
+  // Snake
+  for (unsigned short i = 0; i < game.snake_length; i++) {
+    char c = game.snake[i].is_head ? '@' : '#';
+    SetGlyph(vt, c, GREEN, BG, game.snake[i].row, game.snake[i].col);
+  }
+}
+
+// The world glyph at (row, col), which must be inside 'chunk'
+static char WorldGlyph(const WorldChunk_t *chunk, unsigned short row, unsigned short col) {
+  bool on_row_wall = (row == 2 || row == world.rows - 1) && col >= 2 && col <= world.cols - 2;
+  bool on_col_wall = (col == 2 || col == world.cols - 2) && row >= 2 && row <= world.rows - 1;
+
+  if (on_row_wall && on_col_wall) return '+';
+  if (on_row_wall) return '-';
+  if (on_col_wall) return '|';
+  if (chunk != NULL && WorldChunkCell(chunk, row, col) == WORLD_FOOD) return '*';
+  return ' ';
+}
+
+static void DrawMinimap(VTerm_t *vt, unsigned short top, int cam_row, int cam_col, unsigned short view_rows, unsigned short view_cols) {
+  unsigned short mm_rows = view_rows / 4, mm_cols = view_cols / 4;
+  if (mm_rows < 4) mm_rows = 4;
+  if (mm_rows > 16) mm_rows = 16;
+  if (mm_cols < 8) mm_cols = 8;
+  if (mm_cols > 48) mm_cols = 48;
+
+  // Top right corner of the viewport
+  unsigned short r1 = top + 1, r2 = r1 + mm_rows + 1;
+  unsigned short c2 = vt->cols - 2, c1 = c2 - mm_cols - 1;
+
+  SetRect(vt, WHITE, BG, r1, c1, r2, c2);
+
+  // Everything in minimap cells
+  unsigned head_y = (unsigned)game.snake[0].row * mm_rows / world.rows;
+  unsigned head_x = (unsigned)game.snake[0].col * mm_cols / world.cols;
+  unsigned cam_y1 = (unsigned)cam_row * mm_rows / world.rows;
+  unsigned cam_y2 = (unsigned)(cam_row + view_rows - 1) * mm_rows / world.rows;
+  unsigned cam_x1 = (unsigned)cam_col * mm_cols / world.cols;
+  unsigned cam_x2 = (unsigned)(cam_col + view_cols - 1) * mm_cols / world.cols;
+
+  for (unsigned short y = 0; y < mm_rows; y++) {
+    for (unsigned short x = 0; x < mm_cols; x++) {
+      // A few samples per minimap cell keep this independent of the world size
+      bool touched = false;
+      for (unsigned sy = 0; sy < 3 && !touched; sy++) {
+        unsigned short row = (unsigned short)(((unsigned)y * 3 + sy) * world.rows / (mm_rows * 3u));
+        for (unsigned sx = 0; sx < 3 && !touched; sx++) {
+          unsigned short col = (unsigned short)(((unsigned)x * 3 + sx) * world.cols / (mm_cols * 3u));
+          touched = WorldIsTouched(&world, row, col);
+        }
+      }
+
+      char c = touched ? '.' : ' ';
+      if (y >= cam_y1 && y <= cam_y2 && x >= cam_x1 && x <= cam_x2) c = ':';
+      if (y == head_y && x == head_x) c = '@';
+
+      SetGlyph(vt, c, c == '@' ? GREEN : WHITE, BG, r1 + 1 + y, c1 + 1 + x);
+    }
+  }
+}
+
+// Draws the part of the world around the head. The cost depends only on
+// the terminal size; chunks are looked up once per run of cells.
+static void DrawWorld(VTerm_t *vt) {
+  // Row 1 is the status line, the viewport is everything below it
+  unsigned short top = 2, left = 1;
+  unsigned short view_rows = vt->rows - top, view_cols = vt->cols - left;
+
+  // The camera follows the head and stops at the world edges
+  int cam_row = game.snake[0].row - view_rows / 2;
+  int cam_col = game.snake[0].col - view_cols / 2;
+  if (cam_row > world.rows - view_rows) cam_row = world.rows - view_rows;
+  if (cam_col > world.cols - view_cols) cam_col = world.cols - view_cols;
+  if (cam_row < 0) cam_row = 0;
+  if (cam_col < 0) cam_col = 0;
+
+  VTermReset(vt, ' ', BG, BG);
+
+  for (unsigned short y = 0; y < view_rows && cam_row + y < world.rows; y++) {
+    unsigned short row = cam_row + y;
+    unsigned short x = 0;
+
+    while (x < view_cols && cam_col + x < world.cols) {
+      unsigned short col = cam_col + x;
+      const WorldChunk_t *chunk = WorldGetChunk(&world, row, col);
+
+      unsigned short run = WORLD_CHUNK - (col & (WORLD_CHUNK - 1));
+      if (run > view_cols - x) run = view_cols - x;
+      if (col + run > world.cols) run = world.cols - col;
+
+      for (unsigned short i = 0; i < run; i++) {
+        char c = WorldGlyph(chunk, row, col + i);
+        if (c != ' ') SetGlyph(vt, c, c == '*' ? RED : WHITE, BG, top + y, left + x + i);
+      }
+
+      x += run;
+    }
+  }
+
+  // Snake
+  for (unsigned short i = 0; i < game.snake_length; i++) {
+    int y = game.snake[i].row - cam_row, x = game.snake[i].col - cam_col;
+    if (y < 0 || y >= view_rows || x < 0 || x >= view_cols) continue;
+
+    char c = game.snake[i].is_head ? '@' : '#';
+    SetGlyph(vt, c, GREEN, BG, top + y, left + x);
+  }
+
+  DrawMinimap(vt, top, cam_row, cam_col, view_rows, view_cols);
+
+  // Status line
+  char buff[128];
+  snprintf(buff, sizeof(buff), "Score: %d Best: %d Lifes: %d  At %u,%u  Chunks: %zu (%zu KB)",
+    game.score, game.best_score, game.lifes, game.snake[0].row, game.snake[0].col,
+    world.chunks_touched, world.chunks_touched * sizeof(WorldChunk_t) / 1024);
+  if ((size_t)(vt->cols - 2) < sizeof(buff)) buff[vt->cols - 2] = '\0';
+  SetText(vt, buff, WHITE, BG, 1, 1);
+}
+
+// SetText(...) cut off at the right edge, for lines wider than the window
+static void SetClippedText(VTerm_t *vt, char *text, unsigned short row, unsigned short col) {
+  if (col >= vt->cols) return;
+  if (strlen(text) > (size_t)(vt->cols - col)) text[vt->cols - col] = '\0';
+  SetText(vt, text, WHITE, BG, row, col);
+}
+
+// Frame timings in the top left corner of the board, in microseconds
+static void DrawStatsOverlay(VTerm_t *vt) {
+  char buff[64];
+  unsigned short row = 4, col = 4;
+
+  snprintf(buff, sizeof(buff), " %-8s %7s %7s %7s %7s ", "us", "last", "p50", "p99", "max");
+  SetClippedText(vt, buff, row++, col);
+
+  for (unsigned p = 0; p < STATS_PHASE_COUNT; p++) {
+    snprintf(buff, sizeof(buff), " %-8s %7.1f %7.1f %7.1f %7.1f ", stats_phase_names[p],
+      stats.last[p] / 1000.0,
+      StatsPercentile(&stats, (StatsPhase_t)p, 0.50) / 1000.0,
+      StatsPercentile(&stats, (StatsPhase_t)p, 0.99) / 1000.0,
+      stats.phases[p].max / 1000.0);
+    SetClippedText(vt, buff, row++, col);
+  }
+
+  // As wide as the lines above
+  snprintf(buff, sizeof(buff), " frames %-33llu ", (unsigned long long)stats.frame_count);
+  SetClippedText(vt, buff, row, col);
+}
+
+// DelayMs(ms) that also notes when the next key arrives
+static void WaitForTick(unsigned long ms) {
+  uint64_t deadline = StatsNow() + ms * 1000000ull;
+
+  for (uint64_t now = StatsNow(); now < deadline; now = StatsNow()) {
+    if (key_arrived != 0) {
+      usleep((deadline - now) / 1000);
+      break;
+    }
+    if (WaitForInput((deadline - now + 999999) / 1000000))
+      key_arrived = StatsNow();
+  }
+}
+
 static void GameScreenScene(VTerm_t *vt) {
   ex_scene = scene;
 
+  HandleResize(vt);
+
+  StatsBegin(&stats);
+
+  MoveDir_t dir_before = game.moving_dir, ex_dir_before = game.ex_moving_dir;
+
   Key_t k = GetKeyPressed();
+
+  uint64_t key_decoded = 0;
+  if (latency_mode && k != KEY_NONE) {
+    key_decoded = StatsNow();
+    // It came in while the last frame was busy, or getchar() had it buffered
+    if (key_arrived == 0) key_arrived = key_decoded;
+  }
   if (k != KEY_NONE) {
     switch (k) {
       case KEY_W:
       case KEY_ARROW_UP:
-        ex_moving_dir = moving_dir;
-        moving_dir = UP;
+        autopilot = false; // The player takes over
+        GameSetDirection(&game, UP);
         break;
       case KEY_S:
       case KEY_ARROW_DOWN:
-        ex_moving_dir = moving_dir;
-        moving_dir = DOWN;
+        autopilot = false; // The player takes over
+        GameSetDirection(&game, DOWN);
         break;
       case KEY_D:
       case KEY_ARROW_RIGHT:
-        ex_moving_dir = moving_dir;
-        moving_dir = RIGHT;
+        autopilot = false; // The player takes over
+        GameSetDirection(&game, RIGHT);
         break;
       case KEY_A:
       case KEY_ARROW_LEFT:
-        ex_moving_dir = moving_dir;
-        moving_dir = LEFT;
+        autopilot = false; // The player takes over
+        GameSetDirection(&game, LEFT);
+        break;
+      case KEY_P:
+        // The bot plans over the whole board, too big in a world
+        autopilot = !autopilot && !world_mode;
+        BotForgetPath(&bot);
+        break;
+      case KEY_T:
+        stats_overlay = !stats_overlay;
         break;
       case KEY_Q:
       case KEY_ESC:
         scene = PAUSE_MENU;
+        game_resumable = true;
+        SaveGame();
         break;
       default: 
         break;
     }
   }
 
-  UpdateSnakePosition();
+  StatsMark(&stats, STATS_INPUT);
 
-  bool hit_wall = CheckWallCollision(vt);
-  if (hit_wall) {
-    scene = LOSE_MESSAGE;
+  if (autopilot) {
+    MoveDir_t dir = BotNextMove(&bot, &game);
+    if (dir != game.moving_dir)
+      GameSetDirection(&game, dir);
   }
 
-  bool hit_food = CheckFoodCollision();
-  if (hit_food) {
-    GrowSnake();
-    SpawnFood(vt);
-  }
+  // What a replay needs to repeat this tick
+  uint8_t event = pending_event;
+  pending_event = 0;
+  if (game.moving_dir != dir_before || game.ex_moving_dir != ex_dir_before)
+    event |= (uint8_t)(game.moving_dir + 1);
 
-  bool hit_itself = CheckSelfCollision();
-  if (hit_itself) {
-    ChopSnake();
+  unsigned events = GameStep(&game);
+  if (events & GAME_HIT_WALL) {
+    scene = LOSE_MESSAGE;
   }
 
-  VTermReset(vt, ' ', BG, BG);
+  // In a large world the food lives in the chunks
+  if (world_mode && WorldTakeFood(&world, game.snake[0].row, game.snake[0].col))
+    GameGrowSnake(&game);
 
-  // Borders
-  SetRect(vt, WHITE, BG, 2, 2, vt->rows - 1, vt->cols - 2);
+  RecorderTick(&recorder, &game, event);
 
-  // Score
-  char buff[31];
-  sprintf(buff, "Score: %d Best score: %d", score, best_score);
-  SetText(vt, buff, WHITE, BG, 3, 4);
+  if (game.score == SCORE_TO_WIN) scene = WIN_MESSAGE;
+  if (game.lifes == 0) scene = LOSE_MESSAGE;
 
-  // Lifes
-  sprintf(buff, "Lifes: ");
-  for (unsigned short i = 0; i < lifes; i++) {
-    strcat(buff, "@ ");
-  }
-  SetText(vt, buff, WHITE, BG, 3, vt->cols - 16);
+  // A game that ended is scored, not resumed
+  game_resumable = scene != WIN_MESSAGE && scene != LOSE_MESSAGE;
 
-  // Food
-  SetGlyph(vt, '*', RED, BG, food.row, food.col);
+  StatsMark(&stats, STATS_UPDATE);
 
-  // Snake
-  for (unsigned short i = 0; i < snake_length; i++) {
-    char c = snake[i].is_head ? '@' : '#';
-    SetGlyph(vt, c, GREEN, BG, snake[i].row, snake[i].col);
-  }
+  if (world_mode)
+    DrawWorld(vt);
+  else
+    DrawBoard(vt);
 
-  if (score == SCORE_TO_WIN) scene = WIN_MESSAGE;
-  if (lifes == 0) scene = LOSE_MESSAGE;
+  if (stats_overlay)
+    DrawStatsOverlay(vt);
 
-  UpdateWindow(vt);
-  DelayMs(30);
+  StatsMark(&stats, STATS_DRAW);
+
+  PresentFrame(vt);
+
+  StatsMark(&stats, STATS_PRESENT);
+  StatsEnd(&stats);
+
+  if (key_decoded != 0) {
+    uint64_t written = StatsNow();
+    tcdrain(STDOUT_FILENO);
+    uint64_t drained = StatsNow();
+
+    StatsRecord(&latency[LATENCY_WAIT],  key_decoded - key_arrived);
+    StatsRecord(&latency[LATENCY_FRAME], written - key_decoded);
+    StatsRecord(&latency[LATENCY_DRAIN], drained - written);
+    StatsRecord(&latency[LATENCY_TOTAL], drained - key_arrived);
+    key_arrived = 0;
+  }
+
+  if (latency_mode)
+    WaitForTick(30);
+  else
+    DelayMs(30);
 }
 
 static void HelpScreenScene(VTerm_t* vt) {
@@ -444,23 +737,28 @@ static void HelpScreenScene(VTerm_t* vt) {
   unsigned short text_width  = strlen(text[0]);
   unsigned short text_height = sizeof(text) / sizeof(text[0]);
 
-  // Row (r1) and col (c1) of the top left corner
-  unsigned short r1 = (vt->rows - text_height) / 2;
-  unsigned short c1 = (vt->cols - text_width)  / 2;
+  // Drawn again if the window changes while waiting for the key
+  Key_t k = KEY_NONE;
+  bool redraw = true;
+  while (k == KEY_NONE) {
+    if (HandleResize(vt) || redraw) {
+      // Row (r1) and col (c1) of the top left corner
+      unsigned short r1 = (vt->rows - text_height) / 2;
+      unsigned short c1 = (vt->cols - text_width)  / 2;
 
-  // Row (r2) and col (c2) of the bottom right corner
-  unsigned short r2 = (vt->rows + text_height) / 2 + 1;
-  unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
+      // Row (r2) and col (c2) of the bottom right corner
+      unsigned short r2 = (vt->rows + text_height) / 2 + 1;
+      unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
 
-  VTermReset(vt, ' ', BG, BG);
+      VTermReset(vt, ' ', BG, BG);
 
-  SetRect(vt, WHITE, BG, r1, c1, r2, c2);
-  SetMultilineText(vt, text, text_height, WHITE, BG, r1 + 1, c1 + 1);
+      SetRect(vt, WHITE, BG, r1, c1, r2, c2);
+      SetMultilineText(vt, text, text_height, WHITE, BG, r1 + 1, c1 + 1);
 
-  UpdateWindow(vt);
+      PresentFrame(vt);
+      redraw = false;
+    }
 
-  Key_t k = GetKeyPressed();
-  while (k == KEY_NONE) {
     // Halt the program untill any key is pressed
     k = GetKeyPressed();
     DelayMs(10);
@@ -479,31 +777,39 @@ static void WinMessageScene(VTerm_t *vt) {
   unsigned short text_width  = strlen(text[0]);
   unsigned short text_height = sizeof(text) / sizeof(text[0]);
 
-  // Row (r1) and col (c1) of the top left corner
-  unsigned short r1 = (vt->rows - text_height) / 2;
-  unsigned short c1 = (vt->cols - text_width)  / 2;
+  // Drawn again if the window changes while waiting for the key
+  Key_t k = KEY_NONE;
+  bool redraw = true;
+  while (k == KEY_NONE) {
+    if (HandleResize(vt) || redraw) {
+      // Row (r1) and col (c1) of the top left corner
+      unsigned short r1 = (vt->rows - text_height) / 2;
+      unsigned short c1 = (vt->cols - text_width)  / 2;
 
-  // Row (r2) and col (c2) of the bottom right corner
-  unsigned short r2 = (vt->rows + text_height) / 2 + 1;
-  unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
+      // Row (r2) and col (c2) of the bottom right corner
+      unsigned short r2 = (vt->rows + text_height) / 2 + 1;
+      unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
 
-  VTermReset(vt, ' ', BG, BG);
+      VTermReset(vt, ' ', BG, BG);
 
-  SetRect(vt, WHITE, BG, r1, c1, r2, c2);
-  SetMultilineText(vt, text, text_height, GREEN, BG, r1 + 1, c1 + 1);
+      SetRect(vt, WHITE, BG, r1, c1, r2, c2);
+      SetMultilineText(vt, text, text_height, GREEN, BG, r1 + 1, c1 + 1);
 
-  UpdateWindow(vt);
-  DelayMs(1000);
+      PresentFrame(vt);
+      if (redraw) DelayMs(1000);
+      redraw = false;
+    }
+
+    // The autopilot keeps playing on its own (attract mode)
+    if (autopilot) break;
 
-  Key_t k = GetKeyPressed();
-  while (k == KEY_NONE) {
     // Halt the program untill any key is pressed
     k = GetKeyPressed();
     DelayMs(10);
   }
 
-  ResetGame(vt, true);
-  scene = START_MENU;
+  NewGame(true);
+  scene = autopilot ? GAME_SCREEN : START_MENU;
 }
 
 static void LoseMessageScene(VTerm_t *vt) {
@@ -516,31 +822,261 @@ static void LoseMessageScene(VTerm_t *vt) {
   unsigned short text_width  = strlen(text[0]);
   unsigned short text_height = sizeof(text) / sizeof(text[0]);
 
-  // Row (r1) and col (c1) of the top left corner
-  unsigned short r1 = (vt->rows - text_height) / 2;
-  unsigned short c1 = (vt->cols - text_width)  / 2;
+  // Drawn again if the window changes while waiting for the key
+  Key_t k = KEY_NONE;
+  bool redraw = true;
+  while (k == KEY_NONE) {
+    if (HandleResize(vt) || redraw) {
+      // Row (r1) and col (c1) of the top left corner
+      unsigned short r1 = (vt->rows - text_height) / 2;
+      unsigned short c1 = (vt->cols - text_width)  / 2;
 
-  // Row (r2) and col (c2) of the bottom right corner
-  unsigned short r2 = (vt->rows + text_height) / 2 + 1;
-  unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
+      // Row (r2) and col (c2) of the bottom right corner
+      unsigned short r2 = (vt->rows + text_height) / 2 + 1;
+      unsigned short c2 = (vt->cols + text_width)  / 2 + 1;
 
-  VTermReset(vt, ' ', BG, BG);
+      VTermReset(vt, ' ', BG, BG);
 
-  SetRect(vt, WHITE, BG, r1, c1, r2, c2);
-  SetMultilineText(vt, text, text_height, RED, BG, r1 + 1, c1 + 1);
+      SetRect(vt, WHITE, BG, r1, c1, r2, c2);
+      SetMultilineText(vt, text, text_height, RED, BG, r1 + 1, c1 + 1);
+
+      PresentFrame(vt);
+      if (redraw) DelayMs(1000);
+      redraw = false;
+    }
 
-  UpdateWindow(vt);
-  DelayMs(1000);
+    // The autopilot keeps playing on its own (attract mode)
+    if (autopilot) break;
 
-  Key_t k = GetKeyPressed();
-  while (k == KEY_NONE) {
     // Halt the program untill any key is pressed
     k = GetKeyPressed();
     DelayMs(10);
   }
 
-  ResetGame(vt, false);
-  scene = START_MENU;
+  NewGame(false);
+  scene = autopilot ? GAME_SCREEN : START_MENU;
+}
+
+static void ArenaScreenScene(VTerm_t *vt) {
+  // Snake colors, picked by id
+  static const Color_t palette[] = {
+    RGB(0, 245, 0),   RGB(245, 245, 0), RGB(0, 200, 245), RGB(245, 120, 0),
+    RGB(200, 0, 245), RGB(245, 0, 140), RGB(140, 245, 140), RGB(245, 245, 245)
+  };
+  static const unsigned palette_size = sizeof(palette) / sizeof(palette[0]);
+
+  HandleResize(vt);
+
+  Key_t k = GetKeyPressed();
+  if (k == KEY_Q || k == KEY_ESC) {
+    game_should_quit = true;
+    return;
+  }
+
+  ArenaStep(&arena);
+
+  VTermReset(vt, ' ', BG, BG);
+
+  // Borders
+  SetRect(vt, WHITE, BG, 2, 2, vt->rows - 1, vt->cols - 2);
+
+  // Stats, above the border
+  char buff[96];
+  snprintf(buff, sizeof(buff), "Arena: %u/%u alive  food %u  longest %u  tick %llu",
+    arena.alive_count, arena.count, arena.food_count, arena.longest, arena.tick);
+  if ((size_t)(vt->cols - 4) < sizeof(buff)) buff[vt->cols - 4] = '\0';
+  SetText(vt, buff, WHITE, BG, 1, 3);
+
+  // Bodies and food straight from the occupancy grid
+  for (unsigned short row = 3; row < vt->rows - 1; row++) {
+    const uint32_t *line = arena.grid + row * arena.cols;
+    for (unsigned short col = 3; col < vt->cols - 2; col++) {
+      if (line[col] == ARENA_FOOD)
+        SetGlyph(vt, '*', RED, BG, row, col);
+      else if (line[col] >= ARENA_SNAKE)
+        SetGlyph(vt, '#', palette[(line[col] - ARENA_SNAKE) % palette_size], BG, row, col);
+    }
+  }
+
+  // Heads
+  for (unsigned i = 0; i < arena.count; i++) {
+    if (!arena.alive[i]) continue;
+    uint32_t head = ArenaHead(&arena, i);
+    SetGlyph(vt, '@', palette[i % palette_size], BG, head / arena.cols, head % arena.cols);
+  }
+
+  PresentFrame(vt);
+  DelayMs(30);
+}
+
+// Plays a recording through the normal renderer at the normal speed
+static void ReplayScene(VTerm_t *vt) {
+  uint64_t tick = 0;
+  bool paused = false;
+
+  ReplaySeek(&replay, &game, 0);
+
+  while (!game_should_quit) {
+    HandleResize(vt);
+
+    Key_t k = GetKeyPressed();
+    switch (k) {
+      case KEY_D:
+      case KEY_ARROW_RIGHT:
+        tick = tick + RECORD_KEYFRAME_INTERVAL < replay.tick_count ? tick + RECORD_KEYFRAME_INTERVAL : replay.tick_count;
+        ReplaySeek(&replay, &game, tick);
+        break;
+      case KEY_A:
+      case KEY_ARROW_LEFT:
+        tick = tick > RECORD_KEYFRAME_INTERVAL ? tick - RECORD_KEYFRAME_INTERVAL : 0;
+        ReplaySeek(&replay, &game, tick);
+        break;
+      case KEY_P:
+        paused = !paused;
+        break;
+      case KEY_Q:
+      case KEY_ESC:
+        game_should_quit = true;
+        break;
+      default:
+        break;
+    }
+
+    if (!paused && tick < replay.tick_count)
+      ReplayStep(&replay, &game, tick++);
+
+    DrawBoard(vt);
+
+    char buff[96];
+    snprintf(buff, sizeof(buff), "Replay %llu/%llu%s  A/D seek  P pause  Q quit",
+      (unsigned long long)tick, (unsigned long long)replay.tick_count,
+      tick == replay.tick_count ? " (end)" : paused ? " (paused)" : "");
+    if ((size_t)(vt->cols - 4) < sizeof(buff)) buff[vt->cols - 4] = '\0';
+    SetText(vt, buff, WHITE, BG, 1, 3);
+
+    PresentFrame(vt);
+    DelayMs(30);
+  }
+}
+
+// Plays a recording as fast as possible and checks it against its keyframes
+static int RunHeadlessReplay(void) {
+  uint64_t at;
+  if (!ReplayKeyframe(&replay, 0, &game, &at)) {
+    fprintf(stderr, "  \033[31mError:\033[0m The first keyframe of '%s' is damaged\n", replay_path);
+    return EXIT_FAILURE;
+  }
+
+  uint64_t next_keyframe = 1, mismatches = 0;
+  uint8_t expected[GAME_SAVE_MAX], actual[GAME_SAVE_MAX];
+
+  struct timespec t1, t2;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  for (uint64_t tick = 0; tick < replay.tick_count; tick++) {
+    ReplayStep(&replay, &game, tick);
+
+    Game_t keyframe;
+    if (next_keyframe < replay.keyframe_count &&
+        ReplayKeyframe(&replay, next_keyframe, &keyframe, &at) && at == tick + 1) {
+      size_t size = GameSave(&keyframe, expected);
+      if (size != GameSave(&game, actual) || memcmp(expected, actual, size) != 0)
+        mismatches++;
+      next_keyframe++;
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  double elapsed = (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9;
+
+  printf("ticks        %llu\n", (unsigned long long)replay.tick_count);
+  printf("keyframes    %llu (%llu mismatched)\n", (unsigned long long)replay.keyframe_count, (unsigned long long)mismatches);
+  printf("elapsed      %.6f s (%.0f ticks/s)\n", elapsed, elapsed > 0 ? replay.tick_count / elapsed : 0.0);
+  printf("final state  score %u, best %u, lifes %u, length %u\n", game.score, game.best_score, game.lifes, game.snake_length);
+
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void StopRecording(void) {
+  RecorderClose(&recorder);
+}
+
+static void StopExport(void) {
+  ExportClose(&frame_export);
+}
+
+static void StopSpectating(void) {
+  SpectateDeinit(&spectate);
+}
+
+static void SaveOnExit(void) {
+  // Quit while the end of the game was shown
+  if (scene == WIN_MESSAGE || scene == LOSE_MESSAGE)
+    RecordScore();
+  SaveGame();
+}
+
+// Finds $XDG_STATE_HOME/snake or ~/.local/state/snake for the saved game and
+// the high scores, creating it if needed. False if there is none.
+static bool FindStateDir(void) {
+  char dir[sizeof(save_path) - 16];
+  const char *state = getenv("XDG_STATE_HOME"), *home = getenv("HOME");
+
+  int length;
+  if (state != NULL && state[0] == '/')
+    length = snprintf(dir, sizeof(dir), "%s/snake", state);
+  else if (home != NULL && home[0] == '/')
+    length = snprintf(dir, sizeof(dir), "%s/.local/state/snake", home);
+  else
+    return false;
+  if (length < 0 || length >= (int)sizeof(dir)) return false;
+
+  // mkdir -p
+  for (char *p = dir + 1; ; p++) {
+    if (*p != '/' && *p != '\0') continue;
+    char c = *p;
+    *p = '\0';
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return false;
+    *p = c;
+    if (c == '\0') break;
+  }
+
+  sprintf(save_path, "%s/save", dir);
+  sprintf(scores_path, "%s/scores", dir);
+  return true;
+}
+
+static void PrintScores(void) {
+  if (scores.count == 0) {
+    printf("No high scores yet\n");
+    return;
+  }
+
+  for (unsigned i = 0; i < scores.count; i++) {
+    char date[32] = "";
+    time_t when = (time_t)scores.entries[i].when;
+    struct tm *tm = localtime(&when);
+    if (tm != NULL) strftime(date, sizeof(date), "%Y-%m-%d %H:%M", tm);
+    printf("%2u. %5u  %s\n", i + 1, scores.entries[i].score, date);
+  }
+}
+
+static void DumpStats(void) {
+  if (!StatsWriteCsv(&stats, stats_path))
+    fprintf(stderr, "  \033[31mError:\033[0m Couldn't write the frame stats to '%s'\n", stats_path);
+  StatsDeinit(&stats);
+}
+
+static void ReportLatency(void) {
+  fprintf(stderr, "Input-to-display latency of %llu keys (ms):\n",
+    (unsigned long long)latency[LATENCY_TOTAL].count);
+  fprintf(stderr, "  %-6s %8s %8s %8s\n", "", "p50", "p99", "max");
+
+  for (unsigned p = 0; p < LATENCY_PART_COUNT; p++)
+    fprintf(stderr, "  %-6s %8.2f %8.2f %8.2f\n", latency_names[p],
+      StatsHistogramPercentile(&latency[p], 0.50) / 1e6,
+      StatsHistogramPercentile(&latency[p], 0.99) / 1e6,
+      latency[p].max / 1e6);
 }
 
 static void RunGameLoop(VTerm_t *vt) {
@@ -564,12 +1100,19 @@ static void RunGameLoop(VTerm_t *vt) {
       case LOSE_MESSAGE:
         LoseMessageScene(vt);
         break;
+      case ARENA_SCREEN:
+        ArenaScreenScene(vt);
+        break;
       default:
         break;
     }
   }
 }
 
+void HandleSigWinch(int) {
+  window_resized = 1;
+}
+
 void HandleSigInt(int) {
   ResetWindow();
   exit(EXIT_FAILURE); // VTerm will be cleared on exit
@@ -585,14 +1128,127 @@ void HandleSigAbrt(int) {
   exit(EXIT_FAILURE); // VTerm will be cleared on exit
 }
 
-int main(void) {
+static void PrintUsage(const char *name) {
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  --autopilot   let the bot play (attract mode), P toggles it in game\n"
+    "  --arena N     watch N bot snakes fight over the food, Q quits\n"
+    "  --world RxC   play in a scrolling world of R rows and C cols\n"
+    "  --record FILE record the game to FILE\n"
+    "  --replay FILE play FILE back (A/D seek, P pause, Q quit)\n"
+    "  --headless    with --replay: as fast as possible, without a terminal\n"
+    "  --stats FILE  write per-frame timings as CSV to FILE on exit (T shows them)\n"
+    "  --latency     measure key to screen latency, reported on exit\n"
+    "  --export NAME publish the frames in shared memory NAME (see snake-view)\n"
+    "  --spectate PATH stream the game to everyone connecting to socket PATH\n"
+    "  --color MODE  true, 256, 16 or mono colors (default: from TERM and COLORTERM)\n"
+    "  --scores      print the high scores and exit\n"
+    "  --no-save     don't resume the last game, save it or keep high scores\n",
+    name);
+}
+
+static void ParseArgs(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--autopilot") == 0) {
+      autopilot = true;
+      scene = GAME_SCREEN;
+    } else if (strcmp(argv[i], "--arena") == 0 && i + 1 < argc) {
+      arena_snakes = (unsigned)strtoul(argv[++i], NULL, 10);
+      scene = arena_snakes > 0 ? ARENA_SCREEN : scene;
+    } else if (strcmp(argv[i], "--world") == 0 && i + 1 < argc) {
+      if (sscanf(argv[++i], "%hux%hu", &world_rows, &world_cols) != 2 ||
+          world_rows < 25 || world_cols < 42 || world_rows > 65000 || world_cols > 65000) {
+        fprintf(stderr, "  \033[31mError:\033[0m The world must be between 25x42 and 65000x65000\n");
+        exit(EXIT_FAILURE);
+      }
+      world_mode = true;
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay_path = argv[++i];
+    } else if (strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+      stats_path = argv[++i];
+    } else if (strcmp(argv[i], "--spectate") == 0 && i + 1 < argc) {
+      spectate_path = argv[++i];
+    } else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+      export_name = argv[++i];
+    } else if (strcmp(argv[i], "--latency") == 0) {
+      latency_mode = true;
+    } else if (strcmp(argv[i], "--color") == 0 && i + 1 < argc) {
+      ColorMode_t mode;
+      if (!ColorModeFromName(argv[++i], &mode)) {
+        fprintf(stderr, "  \033[31mError:\033[0m The colors are one of true, 256, 16 or mono\n");
+        exit(EXIT_FAILURE);
+      }
+      SetColorMode(mode);
+    } else if (strcmp(argv[i], "--scores") == 0) {
+      show_scores = true;
+    } else if (strcmp(argv[i], "--no-save") == 0) {
+      saving = false;
+    } else {
+      PrintUsage(argv[0]);
+      exit(strcmp(argv[i], "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+  }
+
+  if (world_mode && autopilot) {
+    autopilot = false;
+    scene = START_MENU;
+  }
+
+  // Worlds and arenas don't depend only on Game_t, so they can't be replayed
+  if ((record_path != NULL || replay_path != NULL) && (world_mode || arena_snakes > 0)) {
+    fprintf(stderr, "  \033[31mError:\033[0m --record and --replay only work with the classic board\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (headless && replay_path == NULL) {
+    PrintUsage(argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  // Only the classic game played by a person is saved
+  if (world_mode || arena_snakes > 0 || replay_path != NULL || autopilot)
+    saving = false;
+}
+
+int main(int argc, char **argv) {
+  ParseArgs(argc, argv);
+
+  if (show_scores) {
+    if (!FindStateDir() || !ScoresRead(scores_path, &scores)) {
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't read the high scores\n");
+      exit(EXIT_FAILURE);
+    }
+    PrintScores();
+    return EXIT_SUCCESS;
+  }
+
+  // Unreadable high scores are replaced by the next game's
+  if (saving) {
+    saving = FindStateDir();
+    if (saving) ScoresRead(scores_path, &scores);
+  }
+
+  if (replay_path != NULL && !ReplayOpen(&replay, replay_path)) {
+    fprintf(stderr, "  \033[31mError:\033[0m Couldn't open the recording '%s'\n", replay_path);
+    exit(EXIT_FAILURE);
+  }
+
+  if (headless) {
+    int status = RunHeadlessReplay();
+    ReplayClose(&replay);
+    return status;
+  }
+
   // If the game crashes or CTRL-C is pressed, this will ensure that the window resets before exit.
   // The behavior of signal() varies across UNIX versions; it is better to use sigaction() instead.
   signal(SIGINT, HandleSigInt);
   signal(SIGSEGV, HandleSigSegv);
   signal(SIGABRT, HandleSigAbrt);
-
-  srand(time(NULL));
+  signal(SIGWINCH, HandleSigWinch);
 
   InitWindow();
 
@@ -602,52 +1258,114 @@ int main(void) {
   VTerm_t vt;
   VTermInit(&vt, ++wrs, ++wcs);
   
-  // This is the size of the biggest text box. If the windows is smaller
-  // then the specified size, the game will crush on opening the Help menu.
-  if (wrs < 25 || wcs < 42) {
-    const char *text[] = {
-      "       The window size is too small.        ",
-      "Window must be at least 25x42 (rows X cols)."
-    };
-
-    unsigned short text_width = strlen(text[0]);
-    unsigned short text_height = sizeof(text) / sizeof(text[0]);
-
-    // Row (r1) and col (c1) of the top left corner
-    unsigned short r1 = (vt.rows - text_height) / 2;
-    unsigned short c1 = (vt.cols - text_width)  / 2;
-
-    // Row (r2) and col (c2) of the bottom right corner
-    unsigned short r2 = (vt.rows + text_height) / 2 + 1;
-    unsigned short c2 = (vt.cols + text_width)  / 2 + 1;
-    SetRect(&vt, WHITE, BG, r1, c1, r2, c2);
-    SetMultilineText(&vt, text, text_height, WHITE, BG, r1 + 1, c1 + 1);
-    UpdateWindow(&vt);
+  // Wait for a window that is big enough, then fit the VTerm to it
+  WaitForBigWindow(&vt, &wrs, &wcs);
+  VTermResize(&vt, wrs, wcs);
+
+  // Init the snake and the food
+  if (world_mode) {
+    if (!WorldInit(&world, world_rows, world_cols, (uint64_t)time(NULL))) {
+      VTermDeinit(&vt);
+      ResetWindow();
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for the world in \033[33mmain(...)\033[0m\n");
+      exit(EXIT_FAILURE);
+    }
+    GameInit(&game, world_rows, world_cols, (uint64_t)time(NULL));
+    game.external_food = true;
+    GameSpawnFood(&game);
+  } else if (replay_path != NULL) {
+    // The board of the recording, if it fits into the terminal
+    uint64_t at;
+    if (!ReplayKeyframe(&replay, 0, &game, &at) || game.rows > vt.rows || game.cols > vt.cols) {
+      VTermDeinit(&vt);
+      ResetWindow();
+      fprintf(stderr, "  \033[31mError:\033[0m The recording is damaged or needs a bigger window\n");
+      exit(EXIT_FAILURE);
+    }
+    VTermDeinit(&vt);
+    VTermInit(&vt, game.rows, game.cols);
+  } else {
+    GameInit(&game, vt.rows, vt.cols, (uint64_t)time(NULL));
+
+    // Resume the saved game paused, fitted to this window
+    if (saving && SaveRead(save_path, &game)) {
+      GameResize(&game, vt.rows, vt.cols);
+      game_resumable = true;
+      scene = PAUSE_MENU;
+    }
 
-    Key_t k = GetKeyPressed();
-    while (k == KEY_NONE) {
-      // Halt the program untill any key is pressed
-      k = GetKeyPressed();
-      DelayMs(10);
+    if (scores.count > 0 && game.best_score < scores.entries[0].score)
+      game.best_score = scores.entries[0].score;
+  }
+
+  if (record_path != NULL) {
+    if (!RecorderOpen(&recorder, record_path, &game)) {
+      VTermDeinit(&vt);
+      ResetWindow();
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't create the recording '%s'\n", record_path);
+      exit(EXIT_FAILURE);
+    }
+    // Also runs when the game exits from a signal handler
+    atexit(StopRecording);
+  }
+
+  if (export_name != NULL) {
+    if (!ExportCreate(&frame_export, export_name, vt.rows - 1, vt.cols - 1)) {
+      int error = errno;
+      VTermDeinit(&vt);
+      ExportCreateFailed(error);
     }
+    atexit(StopExport);
+  }
+
+  if (spectate_path != NULL) {
+    if (!SpectateInit(&spectate, spectate_path)) {
+      VTermDeinit(&vt);
+      ResetWindow();
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't listen on '%s'\n", spectate_path);
+      exit(EXIT_FAILURE);
+    }
+    atexit(StopSpectating);
+  }
 
-    // Clean up
+  if (saving)
+    atexit(SaveOnExit);
+
+  StatsInit(&stats, stats_path != NULL);
+  if (stats_path != NULL)
+    atexit(DumpStats);
+  if (latency_mode)
+    atexit(ReportLatency);
+
+  if (!BotInit(&bot, vt.rows, vt.cols)) {
     VTermDeinit(&vt);
     ResetWindow();
+    fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for the autopilot in \033[33mmain(...)\033[0m\n");
     exit(EXIT_FAILURE);
   }
 
-  // Init the snake
-  snake[0].row = wrs / 2;
-  snake[0].col = wcs / 2;
-  snake[0].is_head = true;
-
-  SpawnFood(&vt);
+  if (arena_snakes > 0) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (!ArenaInit(&arena, vt.rows, vt.cols, arena_snakes, arena_snakes, cores > 0 ? (unsigned)cores : 1, (uint64_t)time(NULL))) {
+      VTermDeinit(&vt);
+      ResetWindow();
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't set up the arena in \033[33mmain(...)\033[0m\n");
+      exit(EXIT_FAILURE);
+    }
+  }
 
   // Start main game loop
-  RunGameLoop(&vt);
+  if (replay_path != NULL)
+    ReplayScene(&vt);
+  else
+    RunGameLoop(&vt);
 
   // Clean up
+  ReplayClose(&replay);
+  if (arena_snakes > 0)
+    ArenaDeinit(&arena);
+  WorldDeinit(&world);
+  BotDeinit(&bot);
   VTermDeinit(&vt);
   ResetWindow();
 }
@@ -0,0 +1,405 @@
+// snake-batch: runs many headless games across all cores and prints
+// aggregated statistics. Used to tune board size, tick rate and SCORE_TO_WIN.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <pthread.h>
+
+#define GAME_INCLUDE_IMPL
+#include "game.h"
+
+#define BOT_INCLUDE_IMPL
+#include "bot.h"
+
+#define ARENA_INCLUDE_IMPL
+#include "arena.h"
+
+#define HIST_BUCKET 10
+
+typedef enum Policy { POLICY_RANDOM, POLICY_GREEDY, POLICY_BOT } Policy_t;
+
+typedef enum Death {
+  DEATH_WALL, DEATH_LIVES, DEATH_WON, DEATH_TIMEOUT,
+  DEATH_COUNT
+} Death_t;
+
+static const char *death_names[DEATH_COUNT] = { "wall", "lives", "won", "timeout" };
+
+typedef struct Stats {
+  unsigned long long games, ticks;
+  unsigned long long score_hist[SCORE_TO_WIN + 1];   // Final score
+  unsigned long long length_hist[MAX_SNAKE_LEN + 1]; // Longest snake reached
+  unsigned long long death_hist[DEATH_COUNT];
+  long long plan_ns, plan_ns_max;                    // Autopilot planning time
+} Stats_t;
+
+// Every worker owns its PRNG and its stats; they are only merged after join.
+typedef struct Worker {
+  pthread_t thread;
+  uint64_t rng;
+  Bot_t bot;
+  Stats_t stats;
+} __attribute__((aligned(64))) Worker_t;
+
+// Read-only after ParseArgs(...)
+static struct Config {
+  unsigned long long games;
+  unsigned threads;
+  unsigned chunk;
+  unsigned short rows, cols;
+  unsigned long max_ticks;
+  unsigned long tick_ms;
+  uint64_t seed;
+  Policy_t policy;
+  unsigned arena_snakes, arena_food;
+} config = {
+  .games = 100000,
+  .threads = 0,
+  .chunk = 256,
+  .rows = 24, .cols = 80,
+  .max_ticks = 20000,
+  .tick_ms = 30,
+  .seed = 1,
+  .policy = POLICY_GREEDY
+};
+
+static atomic_ullong next_game = 0;
+
+static uint64_t NextRandom(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static bool IsReverse(MoveDir_t a, MoveDir_t b) {
+  return (a == UP && b == DOWN) || (a == DOWN && b == UP) ||
+         (a == LEFT && b == RIGHT) || (a == RIGHT && b == LEFT);
+}
+
+static void NextCell(MoveDir_t dir, unsigned short *row, unsigned short *col) {
+  switch (dir) {
+    case UP:    --*row; break;
+    case DOWN:  ++*row; break;
+    case RIGHT: ++*col; break;
+    case LEFT:  --*col; break;
+    default: break;
+  }
+}
+
+static bool IsCellDeadly(const Game_t *game, unsigned short row, unsigned short col) {
+  if (row <= 2 || row >= game->rows - 1 || col <= 2 || col >= game->cols - 2)
+    return true;
+
+  // The tail moves away this tick, so it is safe to step on
+  for (unsigned short i = 1; i + 1 < game->snake_length; i++)
+    if (game->snake[i].row == row && game->snake[i].col == col)
+      return true;
+
+  return false;
+}
+
+// Turns at random now and then, never reverses
+static MoveDir_t RandomPolicy(const Game_t *game, uint64_t *rng) {
+  MoveDir_t dir = game->moving_dir;
+
+  if (dir == IDLE || NextRandom(rng) % 8 == 0) {
+    MoveDir_t next = (MoveDir_t)(NextRandom(rng) % 4);
+    if (!IsReverse(next, dir)) dir = next;
+  }
+
+  return dir == IDLE ? UP : dir;
+}
+
+// Heads for the food and avoids dying on the next tick if it can
+static MoveDir_t GreedyPolicy(const Game_t *game, uint64_t *rng) {
+  static const MoveDir_t dirs[] = { UP, DOWN, RIGHT, LEFT };
+
+  const SnakePart_t *head = &game->snake[0];
+  MoveDir_t best = game->moving_dir == IDLE ? UP : game->moving_dir;
+  int best_cost = 1 << 30;
+
+  unsigned offset = (unsigned)(NextRandom(rng) % 4);
+  for (unsigned i = 0; i < 4; i++) {
+    MoveDir_t dir = dirs[(i + offset) % 4];
+    if (IsReverse(dir, game->moving_dir)) continue;
+
+    unsigned short row = head->row, col = head->col;
+    NextCell(dir, &row, &col);
+
+    int cost = abs((int)row - game->food.row) + abs((int)col - game->food.col);
+    if (IsCellDeadly(game, row, col)) cost += 1 << 20;
+
+    if (cost < best_cost) {
+      best_cost = cost;
+      best = dir;
+    }
+  }
+
+  return best;
+}
+
+static void PlayGame(Worker_t *worker, unsigned long long index) {
+  Game_t game;
+  uint64_t game_seed = config.seed + index * 0x9E3779B97F4A7C15ull;
+  GameInit(&game, config.rows, config.cols, game_seed);
+
+  // Reseeding per game keeps the results independent of the thread count
+  worker->rng = game_seed ^ 0xD1B54A32D192ED03ull;
+  BotForgetPath(&worker->bot);
+
+  unsigned short longest = 1;
+  unsigned long ticks = 0;
+  Death_t death = DEATH_TIMEOUT;
+
+  while (ticks < config.max_ticks) {
+    MoveDir_t dir;
+    switch (config.policy) {
+      case POLICY_RANDOM:
+        dir = RandomPolicy(&game, &worker->rng);
+        break;
+      case POLICY_GREEDY:
+        dir = GreedyPolicy(&game, &worker->rng);
+        break;
+      default:
+        dir = BotNextMove(&worker->bot, &game);
+        worker->stats.plan_ns += worker->bot.last_ns;
+        break;
+    }
+
+    if (dir != game.moving_dir)
+      GameSetDirection(&game, dir);
+
+    unsigned events = GameStep(&game);
+    ticks++;
+
+    if (game.snake_length > longest) longest = game.snake_length;
+
+    // Same precedence as the scene switch in GameScreenScene
+    if (game.lifes == 0) { death = DEATH_LIVES; break; }
+    if (events & GAME_WON) { death = DEATH_WON; break; }
+    if (events & GAME_HIT_WALL) { death = DEATH_WALL; break; }
+  }
+
+  Stats_t *stats = &worker->stats;
+  stats->games++;
+  stats->ticks += ticks;
+  stats->score_hist[game.score]++;
+  stats->length_hist[longest]++;
+  stats->death_hist[death]++;
+}
+
+static void *WorkerMain(void *arg) {
+  Worker_t *worker = arg;
+
+  if (config.policy == POLICY_BOT) {
+    if (!BotInit(&worker->bot, config.rows, config.cols)) {
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for the autopilot\n");
+      exit(EXIT_FAILURE);
+    }
+    // No time budget, so the games stay reproducible
+    worker->bot.budget_ns = 0;
+  }
+
+  for (;;) {
+    unsigned long long first = atomic_fetch_add_explicit(&next_game, config.chunk, memory_order_relaxed);
+    if (first >= config.games) break;
+
+    unsigned long long last = first + config.chunk;
+    if (last > config.games) last = config.games;
+
+    for (unsigned long long i = first; i < last; i++)
+      PlayGame(worker, i);
+  }
+
+  if (config.policy == POLICY_BOT) {
+    worker->stats.plan_ns_max = worker->bot.max_ns;
+    BotDeinit(&worker->bot);
+  }
+
+  return NULL;
+}
+
+static void MergeStats(Stats_t *dst, const Stats_t *src) {
+  dst->games += src->games;
+  dst->ticks += src->ticks;
+  for (unsigned i = 0; i <= SCORE_TO_WIN; i++) dst->score_hist[i] += src->score_hist[i];
+  for (unsigned i = 0; i <= MAX_SNAKE_LEN; i++) dst->length_hist[i] += src->length_hist[i];
+  for (unsigned i = 0; i < DEATH_COUNT; i++) dst->death_hist[i] += src->death_hist[i];
+  dst->plan_ns += src->plan_ns;
+  if (dst->plan_ns_max < src->plan_ns_max) dst->plan_ns_max = src->plan_ns_max;
+}
+
+static void PrintHistogram(const char *title, const unsigned long long *hist, unsigned size, unsigned long long total) {
+  printf("\n%s:\n", title);
+
+  for (unsigned first = 0; first < size; first += HIST_BUCKET) {
+    unsigned long long count = 0;
+    for (unsigned i = first; i < first + HIST_BUCKET && i < size; i++) count += hist[i];
+    if (count == 0) continue;
+
+    unsigned last = first + HIST_BUCKET - 1;
+    if (last >= size) last = size - 1;
+
+    double share = total ? (double)count / total : 0.0;
+    char bar[41] = {0};
+    memset(bar, '#', (size_t)(share * 40.0 + 0.5));
+
+    printf("  %3u-%-3u %12llu %6.2f%% %s\n", first, last, count, share * 100.0, bar);
+  }
+}
+
+static void PrintUsage(const char *name) {
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  -n GAMES    number of games to play (default %llu)\n"
+    "  -j THREADS  worker threads (default: all cores)\n"
+    "  -k CHUNK    games handed to a worker at once (default %u)\n"
+    "  -r ROWS     terminal rows to simulate (default %u)\n"
+    "  -c COLS     terminal cols to simulate (default %u)\n"
+    "  -t TICKS    tick limit per game (default %lu)\n"
+    "  -m MS       tick length used for game time stats (default %lu)\n"
+    "  -s SEED     base seed (default %llu)\n"
+    "  -p POLICY   random | greedy | bot (default greedy)\n"
+    "  -A SNAKES   run one arena with this many snakes for -t ticks instead\n"
+    "  -f FOOD     food items in the arena (default: one per snake)\n",
+    name, config.games, config.chunk, config.rows, config.cols,
+    config.max_ticks, config.tick_ms, (unsigned long long)config.seed);
+}
+
+static void ParseArgs(int argc, char **argv) {
+  unsigned long rows = config.rows, cols = config.cols;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:j:k:r:c:t:m:s:p:A:f:h")) != -1) {
+    switch (opt) {
+      case 'n': config.games = strtoull(optarg, NULL, 10); break;
+      case 'j': config.threads = (unsigned)strtoul(optarg, NULL, 10); break;
+      case 'k': config.chunk = (unsigned)strtoul(optarg, NULL, 10); break;
+      case 'r': rows = strtoul(optarg, NULL, 10); break;
+      case 'c': cols = strtoul(optarg, NULL, 10); break;
+      case 't': config.max_ticks = strtoul(optarg, NULL, 10); break;
+      case 'm': config.tick_ms = strtoul(optarg, NULL, 10); break;
+      case 's': config.seed = strtoull(optarg, NULL, 10); break;
+      case 'A': config.arena_snakes = (unsigned)strtoul(optarg, NULL, 10); break;
+      case 'f': config.arena_food = (unsigned)strtoul(optarg, NULL, 10); break;
+      case 'p':
+        if (strcmp(optarg, "random") == 0) config.policy = POLICY_RANDOM;
+        else if (strcmp(optarg, "greedy") == 0) config.policy = POLICY_GREEDY;
+        else if (strcmp(optarg, "bot") == 0) config.policy = POLICY_BOT;
+        else { PrintUsage(argv[0]); exit(EXIT_FAILURE); }
+        break;
+      default:
+        PrintUsage(argv[0]);
+        exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+  }
+
+  // The game adds one row and col to the window size, see main() in snake.c.
+  // The upper bound is the one of --world, so the sizes can't wrap around.
+  if (rows + 1 < 25 || cols + 1 < 42 || rows > 65000 || cols > 65000) {
+    fprintf(stderr, "  \033[31mError:\033[0m Board must be between 25x42 and 65000x65000 (rows X cols)\n");
+    exit(EXIT_FAILURE);
+  }
+  config.rows = (unsigned short)(rows + 1);
+  config.cols = (unsigned short)(cols + 1);
+
+  if (config.threads == 0) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    config.threads = cores > 0 ? (unsigned)cores : 1;
+  }
+
+  if (config.chunk == 0) config.chunk = 1;
+  if (config.arena_food == 0) config.arena_food = config.arena_snakes;
+}
+
+static double NowSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Arena stress run: one board, many snakes, parallel ticks
+static int RunArena(void) {
+  Arena_t arena;
+  if (!ArenaInit(&arena, config.rows, config.cols, config.arena_snakes, config.arena_food, config.threads, config.seed)) {
+    fprintf(stderr, "  \033[31mError:\033[0m Couldn't set up the arena\n");
+    exit(EXIT_FAILURE);
+  }
+
+  double start = NowSeconds();
+  for (unsigned long t = 0; t < config.max_ticks; t++)
+    ArenaStep(&arena);
+  double elapsed = NowSeconds() - start;
+
+  printf("arena        %u snakes, %u food\n", arena.count, arena.food_target);
+  printf("threads      %u\n", arena.threads);
+  printf("board        %ux%u\n", config.rows - 1, config.cols - 1);
+  printf("elapsed      %.3f s\n", elapsed);
+  printf("throughput   %.0f ticks/s, %.0f snake moves/s\n", arena.tick / elapsed, arena.moves / elapsed);
+  printf("deaths       %llu\n", arena.deaths);
+  printf("at the end   %u alive, %u food, longest %u\n", arena.alive_count, arena.food_count, arena.longest);
+
+  ArenaDeinit(&arena);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+  ParseArgs(argc, argv);
+
+  if (config.arena_snakes > 0)
+    return RunArena();
+
+  Worker_t *workers = aligned_alloc(64, sizeof(Worker_t) * config.threads);
+  if (workers == NULL) {
+    fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for workers\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(workers, 0, sizeof(Worker_t) * config.threads);
+
+  double start = NowSeconds();
+
+  for (unsigned i = 0; i < config.threads; i++) {
+    if (pthread_create(&workers[i].thread, NULL, WorkerMain, &workers[i]) != 0) {
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't start worker thread\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  Stats_t total = {0};
+  for (unsigned i = 0; i < config.threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+    MergeStats(&total, &workers[i].stats);
+  }
+
+  double elapsed = NowSeconds() - start;
+
+  printf("games        %llu\n", total.games);
+  printf("threads      %u (chunk %u)\n", config.threads, config.chunk);
+  printf("board        %ux%u, score to win %u\n", config.rows - 1, config.cols - 1, SCORE_TO_WIN);
+  printf("elapsed      %.3f s\n", elapsed);
+  printf("throughput   %.0f games/s, %.0f ticks/s\n", total.games / elapsed, total.ticks / elapsed);
+  if (total.games)
+    printf("mean game    %.1f ticks (%.1f s at %lu ms/tick)\n",
+      (double)total.ticks / total.games,
+      (double)total.ticks / total.games * config.tick_ms / 1000.0,
+      config.tick_ms);
+  if (config.policy == POLICY_BOT && total.ticks)
+    printf("planning     %.2f us/tick mean, %.2f us max\n",
+      total.plan_ns / 1000.0 / total.ticks, total.plan_ns_max / 1000.0);
+
+  printf("\nend of game:\n");
+  for (unsigned i = 0; i < DEATH_COUNT; i++)
+    printf("  %-8s %12llu %6.2f%%\n", death_names[i], total.death_hist[i],
+      total.games ? 100.0 * total.death_hist[i] / total.games : 0.0);
+
+  PrintHistogram("score", total.score_hist, SCORE_TO_WIN + 1, total.games);
+  PrintHistogram("longest snake", total.length_hist, MAX_SNAKE_LEN + 1, total.games);
+
+  free(workers);
+  return EXIT_SUCCESS;
+}
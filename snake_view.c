@@ -0,0 +1,179 @@
+// Reference reader for 'snake --export NAME': attaches to the shared frames
+// and shows them on its own terminal, or just counts them with --count.
+//
+//   ./build/snake --export /snake
+//   ./build/snake-view /snake
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <signal.h>
+
+#define TGUI_INCLUDE_IMPL
+#include "tgui.h"
+
+#define STATS_INCLUDE_IMPL
+#include "stats.h"
+
+#define EXPORT_INCLUDE_IMPL
+#include "export.h"
+
+static Export_t frames;
+static const char *name = "/snake";
+static bool count_only = false;
+
+// What the reader saw
+static uint64_t frames_read = 0, frames_missed = 0, torn_reads = 0;
+
+static void HandleSignal(int) {
+  if (!count_only) ResetWindow();
+  exit(EXIT_FAILURE);
+}
+
+// The game made new frames, e.g. bigger ones after a resize: attach to
+// them, if they show up soon
+static bool Reattach(uint64_t *last) {
+  ExportDetach(&frames);
+  *last = UINT64_MAX;
+
+  for (int tries = 0; tries < 100; tries++) {
+    if (ExportAttach(&frames, name) && !ExportIsClosed(&frames)) return true;
+    ExportDetach(&frames);
+    DelayMs(10);
+  }
+  return false;
+}
+
+// Copies the rows x cols slot into 'vt' (one row and col bigger, like in
+// the game), growing it if the game sent a bigger frame
+static void CopyFrame(VTerm_t *vt, const ExportSlot_t *slot, unsigned short rows, unsigned short cols) {
+  if (vt->rows != rows + 1 || vt->cols != cols + 1) {
+    VTermDeinit(vt);
+    VTermInit(vt, rows + 1, cols + 1);
+  }
+
+  const ExportCell_t *cell = slot->cells;
+  for (unsigned short i = 1; i < vt->rows; i++) {
+    for (unsigned short j = 1; j < vt->cols; j++, cell++) {
+      vt->screen[i][j] = (Glyph_t) {
+        .value = (char)cell->value,
+        .fg_color = RGB(cell->fg[0], cell->fg[1], cell->fg[2]),
+        .bg_color = RGB(cell->bg[0], cell->bg[1], cell->bg[2])
+      };
+    }
+  }
+}
+
+// Only reads the frames in place and checks the sequence numbers
+static void CountFrames(void) {
+  uint64_t last = UINT64_MAX, report_at = StatsNow() + 1000000000ull;
+  uint64_t checksum = 0;
+
+  while (!ExportIsClosed(&frames) || Reattach(&last)) {
+    uint64_t seq;
+    unsigned short rows, cols;
+    const ExportSlot_t *slot = ExportPeek(&frames, &seq, &rows, &cols);
+
+    if (slot != NULL && slot->frame != last) {
+      uint64_t frame = slot->frame, sum = 0;
+      for (size_t i = 0; i < (size_t)rows * cols; i++)
+        sum += slot->cells[i].value;
+
+      if (ExportValidate(slot, seq)) {
+        if (last != UINT64_MAX && frame > last + 1) frames_missed += frame - last - 1;
+        last = frame;
+        checksum = sum;
+        frames_read++;
+      } else {
+        torn_reads++;
+      }
+    } else {
+      DelayMs(1);
+    }
+
+    if (StatsNow() >= report_at) {
+      printf("frames %llu  missed %llu  torn %llu  checksum %llu\n",
+        (unsigned long long)frames_read, (unsigned long long)frames_missed,
+        (unsigned long long)torn_reads, (unsigned long long)checksum);
+      fflush(stdout);
+      report_at += 1000000000ull;
+    }
+  }
+}
+
+static void ShowFrames(void) {
+  VTerm_t vt;
+  VTermInit(&vt, 2, 2);
+  InitWindow();
+
+  uint64_t last = UINT64_MAX;
+
+  while (!ExportIsClosed(&frames) || Reattach(&last)) {
+    Key_t k = GetKeyPressed();
+    if (k == KEY_Q || k == KEY_ESC) break;
+
+    uint64_t seq;
+    unsigned short rows, cols;
+    const ExportSlot_t *slot = ExportPeek(&frames, &seq, &rows, &cols);
+
+    if (slot == NULL || slot->frame == last) {
+      DelayMs(5);
+      continue;
+    }
+
+    uint64_t frame = slot->frame;
+    CopyFrame(&vt, slot, rows, cols);
+
+    // The game lapped us while copying, try the next one
+    if (!ExportValidate(slot, seq)) {
+      torn_reads++;
+      continue;
+    }
+
+    if (last != UINT64_MAX && frame > last + 1) frames_missed += frame - last - 1;
+    last = frame;
+    frames_read++;
+
+    UpdateWindow(&vt);
+  }
+
+  VTermDeinit(&vt);
+  ResetWindow();
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--count") == 0) {
+      count_only = true;
+    } else if (argv[i][0] == '/') {
+      name = argv[i];
+    } else {
+      fprintf(stderr,
+        "Usage: %s [--count] [NAME]\n"
+        "  NAME     shared memory of 'snake --export NAME' (default /snake)\n"
+        "  --count  don't draw the frames, print how many were read per second\n",
+        argv[0]);
+      return strcmp(argv[i], "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  if (!ExportAttach(&frames, name)) {
+    fprintf(stderr, "  \033[31mError:\033[0m Couldn't attach to '%s', is 'snake --export %s' running?\n", name, name);
+    return EXIT_FAILURE;
+  }
+
+  signal(SIGINT, HandleSignal);
+  signal(SIGTERM, HandleSignal);
+
+  if (count_only)
+    CountFrames();
+  else
+    ShowFrames();
+
+  fprintf(stderr, "Read %llu frames, missed %llu, %llu torn reads retried\n",
+    (unsigned long long)frames_read, (unsigned long long)frames_missed, (unsigned long long)torn_reads);
+
+  ExportDetach(&frames);
+  return EXIT_SUCCESS;
+}
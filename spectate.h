@@ -0,0 +1,362 @@
+#ifndef SPECTATE_LIBRARY
+#define SPECTATE_LIBRARY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tgui.h"
+
+#ifndef SPECTATE_MAX_BACKLOG
+#define SPECTATE_MAX_BACKLOG (1 << 20)  // Queued bytes before a client resyncs
+#endif
+
+#ifndef SPECTATE_MAX_RESYNCS
+#define SPECTATE_MAX_RESYNCS 8          // Resyncs in a row before it's dropped
+#endif
+
+typedef struct Spectator Spectator_t;
+
+typedef struct SpectateServer SpectateServer_t;
+
+bool SpectateInit(SpectateServer_t *server, const char *path);
+
+void SpectateDeinit(SpectateServer_t *server);
+
+void SpectateFrame(SpectateServer_t *server, const VTerm_t *vt, const char *diff, size_t size);
+
+#ifdef SPECTATE_INCLUDE_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+// Spectators get the same bytes as the game's terminal: the frame diffs
+// are encoded once by UpdateWindow(...) and copied to every client. A new
+// client first gets a keyframe, which is encoded once per frame however
+// many clients joined. Clients are never waited for; whatever they can't
+// take yet queues up, and a client that falls too far behind gets its
+// queue replaced by the next keyframe, or is dropped if that keeps
+// happening.
+//
+// A client whose terminal has other colors than the game's sends a line
+// with "true", "256", "16" or "mono". Its diffs are then encoded once per
+// frame for all clients with those colors.
+typedef struct Spectator {
+  int fd;
+  bool needs_keyframe;
+  unsigned resyncs;
+
+  ColorMode_t mode;
+  char request[8];              // The line being received
+  unsigned request_size;
+
+  char *queue;                  // Bytes not sent yet, from 'sent' to 'used'
+  size_t sent, used, capacity;
+} Spectator_t;
+
+typedef struct SpectateServer {
+  int listen_fd, epoll_fd;
+  char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+  Spectator_t **clients;
+  size_t count, capacity;
+
+  ColorMode_t mode;                           // Of the game's diffs
+  FrameEncoder_t keyframe[COLOR_MODE_COUNT];  // Always encode full frames
+  FrameEncoder_t diff[COLOR_MODE_COUNT];      // For the other modes
+  unsigned short rows, cols;    // Of the last frame
+  uint64_t frames, dropped;
+} SpectateServer_t;
+
+// Listens on the Unix socket 'path', replacing a stale one
+bool SpectateInit(SpectateServer_t *server, const char *path) {
+  *server = (SpectateServer_t) { .listen_fd = -1, .epoll_fd = -1, .mode = GetColorMode() };
+  for (int m = 0; m < COLOR_MODE_COUNT; m++) {
+    EncoderInit(&server->keyframe[m]);
+    EncoderSetColorMode(&server->keyframe[m], (ColorMode_t)m);
+    EncoderInit(&server->diff[m]);
+    EncoderSetColorMode(&server->diff[m], (ColorMode_t)m);
+  }
+
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  if (strlen(path) >= sizeof(addr.sun_path)) return false;
+  strcpy(addr.sun_path, path);
+  strcpy(server->path, path);
+
+  server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (server->listen_fd < 0 || server->epoll_fd < 0) {
+    SpectateDeinit(server);
+    return false;
+  }
+
+  unlink(path);
+  struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+  if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(server->listen_fd, 16) != 0 ||
+      epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &event) != 0) {
+    SpectateDeinit(server);
+    return false;
+  }
+
+  return true;
+}
+
+static void SpectateRemove(SpectateServer_t *server, Spectator_t *client) {
+  for (size_t i = 0; i < server->count; i++) {
+    if (server->clients[i] != client) continue;
+    server->clients[i] = server->clients[--server->count];
+    break;
+  }
+
+  // Closing the socket also takes it out of the epoll set
+  close(client->fd);
+  free(client->queue);
+  free(client);
+}
+
+void SpectateDeinit(SpectateServer_t *server) {
+  while (server->count > 0)
+    SpectateRemove(server, server->clients[0]);
+  free(server->clients);
+
+  if (server->listen_fd >= 0) {
+    close(server->listen_fd);
+    unlink(server->path);
+  }
+  if (server->epoll_fd >= 0)
+    close(server->epoll_fd);
+
+  for (int m = 0; m < COLOR_MODE_COUNT; m++) {
+    EncoderDeinit(&server->keyframe[m]);
+    EncoderDeinit(&server->diff[m]);
+  }
+  *server = (SpectateServer_t) { .listen_fd = -1, .epoll_fd = -1 };
+}
+
+static void SpectateAccept(SpectateServer_t *server) {
+  for (;;) {
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0) return;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    if (server->count == server->capacity) {
+      size_t capacity = server->capacity * 2 + 8;
+      Spectator_t **clients = realloc(server->clients, capacity * sizeof(Spectator_t *));
+      if (clients == NULL) {
+        close(fd);
+        return;
+      }
+      server->clients = clients;
+      server->capacity = capacity;
+    }
+
+    Spectator_t *client = calloc(1, sizeof(Spectator_t));
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+    if (client == NULL || epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+      free(client);
+      close(fd);
+      return;
+    }
+
+    client->fd = fd;
+    client->needs_keyframe = true;
+    client->mode = server->mode;
+    server->clients[server->count++] = client;
+  }
+}
+
+// Sends as much of the queue as the socket takes. False if the client is gone.
+static bool SpectateFlush(SpectateServer_t *server, Spectator_t *client) {
+  while (client->sent < client->used) {
+    ssize_t sent = send(client->fd, client->queue + client->sent, client->used - client->sent, MSG_NOSIGNAL);
+    if (sent > 0) {
+      client->sent += (size_t)sent;
+    } else if (sent < 0 && errno == EINTR) {
+      continue;
+    } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Come back when the client made room
+      struct epoll_event event = { .events = EPOLLIN | EPOLLOUT, .data.ptr = client };
+      epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  // All caught up
+  if (client->used > 0) {
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+  }
+  client->sent = client->used = 0;
+  client->resyncs = 0;
+  return true;
+}
+
+static bool SpectateQueue(Spectator_t *client, const char *data, size_t size) {
+  // Move the unsent bytes to the front before growing
+  if (client->sent > 0) {
+    memmove(client->queue, client->queue + client->sent, client->used - client->sent);
+    client->used -= client->sent;
+    client->sent = 0;
+  }
+
+  if (client->capacity - client->used < size) {
+    size_t capacity = client->capacity * 2 > client->used + size ? client->capacity * 2 : client->used + size;
+    char *queue = realloc(client->queue, capacity);
+    if (queue == NULL) return false;
+    client->queue = queue;
+    client->capacity = capacity;
+  }
+
+  memcpy(client->queue + client->used, data, size);
+  client->used += size;
+  return true;
+}
+
+// Takes the color mode lines; anything else a client says is dropped
+static void SpectateRequest(Spectator_t *client, char c) {
+  if (c != '\n' && c != '\r') {
+    // Too long for a mode, ignored with the rest of the line
+    if (client->request_size < sizeof(client->request))
+      client->request[client->request_size++] = c;
+    return;
+  }
+
+  ColorMode_t mode;
+  if (client->request_size < sizeof(client->request)) {
+    client->request[client->request_size] = '\0';
+    if (ColorModeFromName(client->request, &mode) && mode != client->mode) {
+      client->mode = mode;
+      client->needs_keyframe = true;
+    }
+  }
+  client->request_size = 0;
+}
+
+// Handles connects, disconnects and clients that can take more, all without
+// blocking
+static void SpectatePoll(SpectateServer_t *server) {
+  struct epoll_event events[64];
+  int count;
+
+  do {
+    count = epoll_wait(server->epoll_fd, events, 64, 0);
+
+    for (int i = 0; i < count; i++) {
+      Spectator_t *client = events[i].data.ptr;
+
+      if (events[i].events == 0) continue; // Its client was removed
+
+      if (client == NULL) {
+        SpectateAccept(server);
+        continue;
+      }
+
+      bool alive = !(events[i].events & (EPOLLERR | EPOLLHUP));
+
+      if (alive && (events[i].events & EPOLLIN)) {
+        char buff[256];
+        ssize_t got = recv(client->fd, buff, sizeof(buff), 0);
+        alive = got > 0 || (got < 0 && (errno == EAGAIN || errno == EINTR));
+        for (ssize_t k = 0; k < got; k++)
+          SpectateRequest(client, buff[k]);
+      }
+
+      if (alive && (events[i].events & EPOLLOUT))
+        alive = SpectateFlush(server, client);
+
+      if (!alive) {
+        // Events for it later in this batch would point to freed memory
+        for (int j = i + 1; j < count; j++)
+          if (events[j].data.ptr == client) events[j].events = 0;
+        SpectateRemove(server, client);
+      }
+    }
+  } while (count == 64);
+}
+
+// Call with every frame the terminal gets: 'vt' and the diff bytes that
+// UpdateWindow(...) writes for it
+void SpectateFrame(SpectateServer_t *server, const VTerm_t *vt, const char *diff, size_t size) {
+  if (server->listen_fd < 0) return;
+
+  SpectatePoll(server);
+  server->frames++;
+
+  // After a resize the diff covers the new size only, so everybody starts
+  // over from a clear screen
+  bool resized = vt->rows != server->rows || vt->cols != server->cols;
+  server->rows = vt->rows;
+  server->cols = vt->cols;
+
+  // The diffs of the modes that spectators use besides the game's. Every
+  // mode in use is encoded each frame, so it stays a diff of the frame
+  // before; a client in a mode that wasn't in use needs a keyframe anyway.
+  const char *diffs[COLOR_MODE_COUNT] = { NULL };
+  size_t diff_sizes[COLOR_MODE_COUNT] = { 0 };
+  diffs[server->mode] = diff;
+  diff_sizes[server->mode] = size;
+
+  for (size_t i = 0; i < server->count; i++) {
+    ColorMode_t mode = server->clients[i]->mode;
+    if (diffs[mode] == NULL)
+      diffs[mode] = EncodeFrame(&server->diff[mode], vt, &diff_sizes[mode]);
+  }
+
+  // One keyframe per mode for everybody who needs one. CAN aborts an escape
+  // sequence cut off by a resync, then the screen starts over.
+  static const char reset[] = "\030\033[0m\033[2J";
+  const char *keyframes[COLOR_MODE_COUNT] = { NULL };
+  size_t keyframe_sizes[COLOR_MODE_COUNT] = { 0 };
+
+  for (size_t i = 0; i < server->count; i++) {
+    Spectator_t *client = server->clients[i];
+
+    // Too far behind: the pending diffs are worth less than a keyframe
+    if (client->used - client->sent > SPECTATE_MAX_BACKLOG) {
+      if (++client->resyncs > SPECTATE_MAX_RESYNCS) {
+        SpectateRemove(server, client);
+        server->dropped++;
+        i--;
+        continue;
+      }
+      client->sent = client->used = 0;
+      client->needs_keyframe = true;
+    }
+
+    if (resized)
+      client->needs_keyframe = true;
+
+    ColorMode_t mode = client->mode;
+    if (client->needs_keyframe && keyframes[mode] == NULL) {
+      EncoderInvalidate(&server->keyframe[mode]);
+      keyframes[mode] = EncodeFrame(&server->keyframe[mode], vt, &keyframe_sizes[mode]);
+    }
+
+    bool queued = client->needs_keyframe ?
+      SpectateQueue(client, reset, sizeof(reset) - 1) && SpectateQueue(client, keyframes[mode], keyframe_sizes[mode]) :
+      SpectateQueue(client, diffs[mode], diff_sizes[mode]);
+    client->needs_keyframe = false;
+
+    if (!queued || !SpectateFlush(server, client)) {
+      SpectateRemove(server, client);
+      i--;
+    }
+  }
+}
+
+#undef SPECTATE_INCLUDE_IMPL
+#endif // SPECTATE_INCLUDE_IMPL
+
+#endif // SPECTATE_LIBRARY
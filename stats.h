@@ -0,0 +1,209 @@
+#ifndef STATS_LIBRARY
+#define STATS_LIBRARY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Histogram buckets: exact below 8 ns, then 8 buckets per power of two
+// (at most 12.5% off) up to 2^STATS_MAX_BITS ns
+#define STATS_SUB_BITS 3
+#define STATS_MAX_BITS 40
+#define STATS_BUCKETS  ((STATS_MAX_BITS - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+
+typedef enum StatsPhase {
+  STATS_INPUT,    // GetKeyPressed(...) and the key handling
+  STATS_UPDATE,   // Autopilot, GameStep(...), world and recorder
+  STATS_DRAW,     // Composing the VTerm
+  STATS_PRESENT,  // UpdateWindow(...)
+  STATS_TOTAL,
+  STATS_PHASE_COUNT
+} StatsPhase_t;
+
+typedef struct StatsHistogram StatsHistogram_t;
+
+typedef struct FrameStats FrameStats_t;
+
+void StatsRecord(StatsHistogram_t *histogram, uint64_t ns);
+
+uint64_t StatsHistogramPercentile(const StatsHistogram_t *histogram, double p);
+
+void StatsInit(FrameStats_t *stats, bool keep_frames);
+
+void StatsDeinit(FrameStats_t *stats);
+
+uint64_t StatsNow(void);
+
+void StatsBegin(FrameStats_t *stats);
+
+void StatsMark(FrameStats_t *stats, StatsPhase_t phase);
+
+void StatsEnd(FrameStats_t *stats);
+
+uint64_t StatsPercentile(const FrameStats_t *stats, StatsPhase_t phase, double p);
+
+bool StatsWriteCsv(const FrameStats_t *stats, const char *path);
+
+#ifdef STATS_INCLUDE_IMPL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *stats_phase_names[STATS_PHASE_COUNT] = {
+  "input", "update", "draw", "present", "total"
+};
+
+typedef struct StatsHistogram {
+  uint64_t count, sum, max;
+  uint32_t buckets[STATS_BUCKETS];
+} StatsHistogram_t;
+
+// Per-frame timings, only kept when they are going to be dumped
+typedef struct StatsFrame {
+  uint32_t ns[STATS_PHASE_COUNT];
+} StatsFrame_t;
+
+// Always-on frame profiler: a few clock reads and counter bumps per frame,
+// cheap enough to leave in release builds
+typedef struct FrameStats {
+  uint64_t frame_count;
+  uint64_t last[STATS_PHASE_COUNT];
+  StatsHistogram_t phases[STATS_PHASE_COUNT];
+
+  uint64_t started, marked;
+  StatsFrame_t current;
+
+  bool keep_frames;
+  StatsFrame_t *frames;
+  size_t frames_used, frames_capacity;
+} FrameStats_t;
+
+void StatsInit(FrameStats_t *stats, bool keep_frames) {
+  memset(stats, 0, sizeof(*stats));
+  stats->keep_frames = keep_frames;
+}
+
+void StatsDeinit(FrameStats_t *stats) {
+  free(stats->frames); stats->frames = NULL;
+  stats->frames_used = stats->frames_capacity = 0;
+}
+
+uint64_t StatsNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static unsigned StatsBucket(uint64_t ns) {
+  if (ns < (1u << STATS_SUB_BITS)) return (unsigned)ns;
+
+  unsigned msb = 63 - (unsigned)__builtin_clzll(ns);
+  if (msb >= STATS_MAX_BITS) return STATS_BUCKETS - 1;
+
+  unsigned shift = msb - STATS_SUB_BITS;
+  return ((shift + 1) << STATS_SUB_BITS) + (unsigned)((ns >> shift) & ((1u << STATS_SUB_BITS) - 1));
+}
+
+// Highest value that falls into 'bucket'
+static uint64_t StatsBucketValue(unsigned bucket) {
+  if (bucket < (1u << STATS_SUB_BITS)) return bucket;
+
+  unsigned shift = (bucket >> STATS_SUB_BITS) - 1;
+  uint64_t mantissa = (1u << STATS_SUB_BITS) + (bucket & ((1u << STATS_SUB_BITS) - 1));
+  return ((mantissa + 1) << shift) - 1;
+}
+
+void StatsRecord(StatsHistogram_t *histogram, uint64_t ns) {
+  histogram->count++;
+  histogram->sum += ns;
+  if (ns > histogram->max) histogram->max = ns;
+  histogram->buckets[StatsBucket(ns)]++;
+}
+
+// The time a fraction 'p' (0..1) of the samples stay at or below, rounded
+// up to the end of its bucket and capped at the real maximum
+uint64_t StatsHistogramPercentile(const StatsHistogram_t *histogram, double p) {
+  if (histogram->count == 0) return 0;
+
+  uint64_t rank = (uint64_t)(p * (double)histogram->count);
+  if (rank >= histogram->count) rank = histogram->count - 1;
+
+  uint64_t seen = 0;
+  for (unsigned i = 0; i < STATS_BUCKETS; i++) {
+    seen += histogram->buckets[i];
+    if (seen > rank) {
+      uint64_t value = StatsBucketValue(i);
+      return value < histogram->max ? value : histogram->max;
+    }
+  }
+
+  return histogram->max;
+}
+
+static void StatsAdd(FrameStats_t *stats, StatsPhase_t phase, uint64_t ns) {
+  StatsRecord(&stats->phases[phase], ns);
+  stats->last[phase] = ns;
+  stats->current.ns[phase] = ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+}
+
+void StatsBegin(FrameStats_t *stats) {
+  stats->started = stats->marked = StatsNow();
+  memset(&stats->current, 0, sizeof(stats->current));
+}
+
+// Ends 'phase': everything since the previous mark is charged to it
+void StatsMark(FrameStats_t *stats, StatsPhase_t phase) {
+  uint64_t now = StatsNow();
+  StatsAdd(stats, phase, now - stats->marked);
+  stats->marked = now;
+}
+
+void StatsEnd(FrameStats_t *stats) {
+  StatsAdd(stats, STATS_TOTAL, stats->marked - stats->started);
+  stats->frame_count++;
+
+  if (!stats->keep_frames) return;
+
+  if (stats->frames_used == stats->frames_capacity) {
+    size_t capacity = stats->frames_capacity * 2 + 1024;
+    StatsFrame_t *frames = realloc(stats->frames, capacity * sizeof(StatsFrame_t));
+    if (frames == NULL) {
+      stats->keep_frames = false; // Keep what we have
+      return;
+    }
+    stats->frames = frames;
+    stats->frames_capacity = capacity;
+  }
+
+  stats->frames[stats->frames_used++] = stats->current;
+}
+
+uint64_t StatsPercentile(const FrameStats_t *stats, StatsPhase_t phase, double p) {
+  return StatsHistogramPercentile(&stats->phases[phase], p);
+}
+
+bool StatsWriteCsv(const FrameStats_t *stats, const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) return false;
+
+  fprintf(file, "frame");
+  for (unsigned p = 0; p < STATS_PHASE_COUNT; p++)
+    fprintf(file, ",%s_ns", stats_phase_names[p]);
+  fprintf(file, "\n");
+
+  for (size_t i = 0; i < stats->frames_used; i++) {
+    fprintf(file, "%zu", i);
+    for (unsigned p = 0; p < STATS_PHASE_COUNT; p++)
+      fprintf(file, ",%u", stats->frames[i].ns[p]);
+    fprintf(file, "\n");
+  }
+
+  return fclose(file) == 0;
+}
+
+#undef STATS_INCLUDE_IMPL
+#endif // STATS_INCLUDE_IMPL
+
+#endif // STATS_LIBRARY
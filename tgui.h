@@ -1,6 +1,9 @@
 #ifndef TGUI_LIBRARY
 #define TGUI_LIBRARY
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #define RGB(R, G, B) (Color_t) { R, G, B }
 
 typedef enum Key Key_t;
@@ -11,6 +14,10 @@ typedef struct Glyph Glyph_t;
 
 typedef struct VTerm VTerm_t;
 
+typedef struct FrameEncoder FrameEncoder_t;
+
+typedef enum ColorMode ColorMode_t;
+
 void InitWindow(void);
 
 void ResetWindow(void);
@@ -19,6 +26,8 @@ void VTermInit(VTerm_t *vt, unsigned short rows, unsigned short cols);
 
 void VTermDeinit(VTerm_t *vt);
 
+void VTermResize(VTerm_t *vt, unsigned short rows, unsigned short cols);
+
 void SetGlyph(VTerm_t *vt, char value, Color_t fg_color, Color_t bg_color, unsigned short row, unsigned short col);
 
 void SetText(VTerm_t *vt, const char *text, Color_t fg_color, Color_t bg_color, unsigned short row, unsigned short col);
@@ -31,6 +40,34 @@ void VTermReset(VTerm_t *vt, char value, Color_t fg_color, Color_t bg_color);
 
 void PrintGlyph(const Glyph_t *glyph, unsigned short row, unsigned short col);
 
+ColorMode_t DetectColorMode(void);
+
+bool ColorModeFromName(const char *name, ColorMode_t *mode);
+
+const char *ColorModeName(ColorMode_t mode);
+
+void SetColorMode(ColorMode_t mode);
+
+ColorMode_t GetColorMode(void);
+
+Color_t MapColor(ColorMode_t mode, Color_t color);
+
+void EncoderInit(FrameEncoder_t *enc);
+
+void EncoderSetColorMode(FrameEncoder_t *enc, ColorMode_t mode);
+
+void EncoderDeinit(FrameEncoder_t *enc);
+
+void EncoderInvalidate(FrameEncoder_t *enc);
+
+const char *EncodeFrame(FrameEncoder_t *enc, const VTerm_t *vt, size_t *size);
+
+const char *EncodeWindow(const VTerm_t *vt, size_t *size);
+
+void WriteWindow(const char *data, size_t size);
+
+void InvalidateWindow(void);
+
 void UpdateWindow(const VTerm_t *vt);
 
 Key_t GetKeyPressed(void);
@@ -39,17 +76,27 @@ void GetWindowSize(unsigned short *cols, unsigned short *rows);
 
 void DelayMs(unsigned long ms);
 
+bool WaitForInput(unsigned long ms);
+
 #ifdef TGUI_INCLUDE_IMPL
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
 
 #include <unistd.h>
 #include <termios.h>
 #include <sys/ioctl.h>
 #include <sys/fcntl.h>
+#include <poll.h>
+
+// All terminal output goes through here. Define it before including the
+// implementation to send the output somewhere else (see bench.c).
+#ifndef TGUI_WRITE
+#define TGUI_WRITE(buff, size) write(STDOUT_FILENO, (buff), (size))
+#endif
 
 typedef enum Key {
 
@@ -84,10 +131,43 @@ typedef struct Glyph {
 
 typedef struct VTerm {
   unsigned short rows, cols;
+  unsigned short rows_capacity, cols_capacity;  // Allocated, for VTermResize(...)
   Glyph_t **screen;
 } VTerm_t;
 
+// How many colors the terminal has. The frames keep their RGB colors, the
+// encoder maps them to what the terminal can show.
+typedef enum ColorMode {
+  COLOR_TRUE,         // 24-bit, "\033[38;2;R;G;Bm"
+  COLOR_256,          // xterm 256 colors, "\033[38;5;Nm"
+  COLOR_16,           // The 8 ANSI colors and their bright variants
+  COLOR_MONO,         // No colors at all
+  COLOR_MODE_COUNT
+} ColorMode_t;
+
+// Turns VTerm frames into the bytes that update a terminal showing the
+// previous frame: only the cells that changed, with cursor moves and color
+// changes only where they are needed.
+typedef struct FrameEncoder {
+  unsigned short rows, cols;
+  Glyph_t *shown;     // rows * cols, what the terminal shows, in its colors
+  bool valid;         // 'shown' matches the terminal
+  ColorMode_t mode;
+
+  char *buff;
+  size_t capacity;
+} FrameEncoder_t;
+
+// What stdout shows, for UpdateWindow(...)
+static FrameEncoder_t window_encoder;
+
+// Of the window, also used by new encoders
+static ColorMode_t window_color_mode = COLOR_TRUE;
+static bool color_mode_chosen = false;
+
 void InitWindow(void) {
+  if (!color_mode_chosen) SetColorMode(DetectColorMode());
+  InvalidateWindow();
   // TODO: Error checks (maybe not necessary?)
   struct termios config;
   // Set cannonical inpute mode and disable echoing
@@ -97,10 +177,11 @@ void InitWindow(void) {
   // Make getchar() function non-blocking
   fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
   // Clear screen, hide the cursor and reset it's position
-  write(STDOUT_FILENO, "\033[2J\033[?25l\033[0;0H", 16); 
+  TGUI_WRITE("\033[2J\033[?25l\033[0;0H", 16); 
 }
 
 void ResetWindow(void) {
+  EncoderDeinit(&window_encoder);
   // TODO: Error checks (maybe not necessary?)
   struct termios config;
   // Unset cannonical input mode and enable echoing
@@ -110,12 +191,14 @@ void ResetWindow(void) {
   // Reset blocking mode for getchar()
   fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) & ~O_NONBLOCK);
   // Clear screen, show the cursor and reset it's position
-  write(STDOUT_FILENO, "\033[0m\033[2J\033[?25h\033[0;0H", 20);
+  TGUI_WRITE("\033[0m\033[2J\033[?25h\033[0;0H", 20);
 }
 
 void VTermInit(VTerm_t *vt, unsigned short rows, unsigned short cols) {
   vt->rows = rows;
   vt->cols = cols;
+  vt->rows_capacity = rows;
+  vt->cols_capacity = cols;
 
   vt->screen = (Glyph_t**) malloc(sizeof(Glyph_t*) * rows);
   if (vt->screen == NULL) {
@@ -142,7 +225,7 @@ void VTermInit(VTerm_t *vt, unsigned short rows, unsigned short cols) {
 }
 
 void VTermDeinit(VTerm_t *vt) {
-  unsigned short rows = vt->rows;
+  unsigned short rows = vt->rows_capacity;
 
   for (unsigned short i = 0; i < rows; i++) {
     Glyph_t *current = *(vt->screen + i);
@@ -152,6 +235,51 @@ void VTermDeinit(VTerm_t *vt) {
   free(vt->screen); vt->screen = NULL;
 }
 
+// Changes the size of 'vt' in place. Shrinking keeps the memory for when it
+// grows again; new cells are empty, like after VTermInit(...).
+void VTermResize(VTerm_t *vt, unsigned short rows, unsigned short cols) {
+  if (cols > vt->cols_capacity) {
+    for (unsigned short i = 0; i < vt->rows_capacity; i++) {
+      Glyph_t *line = (Glyph_t*) realloc(vt->screen[i], sizeof(Glyph_t) * cols);
+      if (line == NULL) {
+        ResetWindow();
+        fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for VTerm in \033[33mVTermResize(...)\033[0m\n");
+        exit(EXIT_FAILURE);
+      }
+      vt->screen[i] = line;
+    }
+    vt->cols_capacity = cols;
+  }
+
+  if (rows > vt->rows_capacity) {
+    Glyph_t **screen = (Glyph_t**) realloc(vt->screen, sizeof(Glyph_t*) * rows);
+    if (screen == NULL) {
+      ResetWindow();
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for VTerm in \033[33mVTermResize(...)\033[0m\n");
+      exit(EXIT_FAILURE);
+    }
+    vt->screen = screen;
+
+    for (unsigned short i = vt->rows_capacity; i < rows; i++) {
+      vt->screen[i] = (Glyph_t*) malloc(sizeof(Glyph_t) * vt->cols_capacity);
+      if (vt->screen[i] == NULL) {
+        ResetWindow();
+        fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for VTerm in \033[33mVTermResize(...)\033[0m\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+    vt->rows_capacity = rows;
+  }
+
+  // Clear what wasn't part of the old screen
+  for (unsigned short i = 0; i < rows; i++)
+    for (unsigned short j = i < vt->rows ? vt->cols : 0; j < cols; j++)
+      vt->screen[i][j] = (Glyph_t) { 0 };
+
+  vt->rows = rows;
+  vt->cols = cols;
+}
+
 void SetGlyph(VTerm_t* vt, char value, Color_t fg_color, Color_t bg_color, unsigned short row, unsigned short col) {
   if (row >= vt->rows) {
     ResetWindow();
@@ -240,34 +368,397 @@ void VTermReset(VTerm_t *vt, char value, Color_t fg_color, Color_t bg_color) {
       SetGlyph(vt, value, fg_color, bg_color, i, j);
 }
 
+// Color tables, filled once by ColorTablesInit(...): the SGR sequences of
+// every palette entry, ready to copy, and the palette entry of every color
+typedef struct Sgr {
+  unsigned char size;
+  char bytes[15];
+} Sgr_t;
+
+static bool color_tables_ready = false;
+static Sgr_t sgr_decimal[256];                 // "0" to "255", for the RGB values
+static Sgr_t sgr_256_fg[256], sgr_256_bg[256];
+static Sgr_t sgr_16_fg[16], sgr_16_bg[16];
+static unsigned char cube_index[256];          // Nearest level of the 6x6x6 cube
+static unsigned char ansi_16[16 * 16 * 16];    // By the high 4 bits of R, G and B
+
+static const unsigned char cube_levels[6] = { 0, 95, 135, 175, 215, 255 };
+
+static void SgrSet(Sgr_t *sgr, const char *format, int value) {
+  sgr->size = (unsigned char)snprintf(sgr->bytes, sizeof(sgr->bytes), format, value);
+}
+
+// The ANSI color with the hue of r, g and b: each channel that is at least
+// half of the brightest one is on, and bright colors get the bright variant
+static unsigned char NearestAnsiColor(int r, int g, int b) {
+  int max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+  if (max < 48) return 0;
+
+  int bits = (r * 2 > max) | (g * 2 > max) << 1 | (b * 2 > max) << 2;
+  if (bits == 7) return max < 128 ? 8 : max < 224 ? 7 : 15;
+  return (unsigned char)(bits + (max >= 192 ? 8 : 0));
+}
+
+static void ColorTablesInit(void) {
+  if (color_tables_ready) return;
+
+  for (int i = 0; i < 256; i++) {
+    SgrSet(&sgr_decimal[i], "%d", i);
+    SgrSet(&sgr_256_fg[i], "\033[38;5;%dm", i);
+    SgrSet(&sgr_256_bg[i], "\033[48;5;%dm", i);
+
+    int level = 0;
+    while (level < 5 && i > (cube_levels[level] + cube_levels[level + 1]) / 2) level++;
+    cube_index[i] = (unsigned char)level;
+  }
+
+  for (int i = 0; i < 16; i++) {
+    SgrSet(&sgr_16_fg[i], "\033[%dm", i < 8 ? 30 + i : 90 + i - 8);
+    SgrSet(&sgr_16_bg[i], "\033[%dm", i < 8 ? 40 + i : 100 + i - 8);
+  }
+
+  for (int i = 0; i < 16 * 16 * 16; i++)
+    ansi_16[i] = NearestAnsiColor((i >> 8) * 17, (i >> 4 & 15) * 17, (i & 15) * 17);
+
+  color_tables_ready = true;
+}
+
+// The xterm palette entry closest to 'color': from the color cube or, for
+// grays, the gray ramp (8, 18, ... 238) if that is closer
+static unsigned char Nearest256Color(Color_t color) {
+  int r = cube_index[color.r], g = cube_index[color.g], b = cube_index[color.b];
+  int dr = color.r - cube_levels[r], dg = color.g - cube_levels[g], db = color.b - cube_levels[b];
+  int cube_distance = dr * dr + dg * dg + db * db;
+
+  int average = (color.r + color.g + color.b) / 3;
+  int gray = average < 8 ? 0 : average > 238 ? 23 : (average - 3) / 10;
+  int level = 8 + gray * 10;
+  dr = color.r - level, dg = color.g - level, db = color.b - level;
+  int gray_distance = dr * dr + dg * dg + db * db;
+
+  return gray_distance < cube_distance ? (unsigned char)(232 + gray) : (unsigned char)(16 + 36 * r + 6 * g + b);
+}
+
+// Guesses what the terminal supports from NO_COLOR, COLORTERM and TERM
+ColorMode_t DetectColorMode(void) {
+  const char *no_color = getenv("NO_COLOR");
+  if (no_color != NULL && no_color[0] != '\0') return COLOR_MONO;
+
+  const char *colorterm = getenv("COLORTERM");
+  if (colorterm != NULL && (strcmp(colorterm, "truecolor") == 0 || strcmp(colorterm, "24bit") == 0))
+    return COLOR_TRUE;
+
+  const char *term = getenv("TERM");
+  if (term == NULL || strcmp(term, "dumb") == 0 || strncmp(term, "vt", 2) == 0)
+    return COLOR_MONO;
+  if (strstr(term, "direct") != NULL) return COLOR_TRUE;
+  if (strstr(term, "256") != NULL) return COLOR_256;
+  return COLOR_16;
+}
+
+static const char *color_mode_names[COLOR_MODE_COUNT] = { "true", "256", "16", "mono" };
+
+bool ColorModeFromName(const char *name, ColorMode_t *mode) {
+  for (int i = 0; i < COLOR_MODE_COUNT; i++) {
+    if (strcmp(name, color_mode_names[i]) == 0) {
+      *mode = (ColorMode_t)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *ColorModeName(ColorMode_t mode) {
+  return mode < COLOR_MODE_COUNT ? color_mode_names[mode] : "?";
+}
+
+// For the window and the encoders made after this, instead of the mode
+// InitWindow(...) would detect
+void SetColorMode(ColorMode_t mode) {
+  window_color_mode = mode;
+  color_mode_chosen = true;
+  EncoderSetColorMode(&window_encoder, mode);
+}
+
+ColorMode_t GetColorMode(void) {
+  return window_color_mode;
+}
+
+// Encodes for the same terminal as the window
+void EncoderInit(FrameEncoder_t *enc) {
+  *enc = (FrameEncoder_t) { 0 };
+  EncoderSetColorMode(enc, window_color_mode);
+}
+
+void EncoderSetColorMode(FrameEncoder_t *enc, ColorMode_t mode) {
+  ColorTablesInit();
+  enc->mode = mode;
+  enc->valid = false;
+}
+
+void EncoderDeinit(FrameEncoder_t *enc) {
+  free(enc->shown);
+  free(enc->buff);
+  *enc = (FrameEncoder_t) { .mode = enc->mode };
+}
+
+// The next frame is sent in full
+void EncoderInvalidate(FrameEncoder_t *enc) {
+  enc->valid = false;
+}
+
+static bool SameColor(Color_t a, Color_t b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static bool SameGlyph(const Glyph_t *a, const Glyph_t *b) {
+  return a->value == b->value && SameColor(a->fg_color, b->fg_color) && SameColor(a->bg_color, b->bg_color);
+}
+
+// EncodeCells(...) is compiled once per color mode, with 'mode' known, so
+// no cell asks which mode is on
+#define TGUI_INLINE static inline __attribute__((always_inline))
+
+// The color as the terminal shows it: the RGB value, or the palette entry in
+// 'r' (all black without colors). Cells are compared in these colors, so
+// a change that the terminal can't show isn't sent.
+TGUI_INLINE Color_t TerminalColor(Color_t color, const ColorMode_t mode) {
+  switch (mode) {
+    case COLOR_256:  return (Color_t) { Nearest256Color(color), 0, 0 };
+    case COLOR_16:   return (Color_t) { ansi_16[(color.r >> 4) << 8 | (color.g >> 4) << 4 | color.b >> 4], 0, 0 };
+    case COLOR_MONO: return (Color_t) { 0, 0, 0 };
+    default:         return color;
+  }
+}
+
+TGUI_INLINE char *PutSgr(char *out, const Sgr_t *sgr) {
+  memcpy(out, sgr->bytes, sizeof(sgr->bytes));  // Only 'size' bytes count
+  return out + sgr->size;
+}
+
+TGUI_INLINE char *PutColor(char *out, Color_t color, bool fg, const ColorMode_t mode) {
+  switch (mode) {
+    case COLOR_256:
+      return PutSgr(out, fg ? &sgr_256_fg[color.r] : &sgr_256_bg[color.r]);
+    case COLOR_16:
+      return PutSgr(out, fg ? &sgr_16_fg[color.r] : &sgr_16_bg[color.r]);
+    case COLOR_MONO:
+      return out;
+    default:
+      memcpy(out, fg ? "\033[38;2;" : "\033[48;2;", 7);
+      out = PutSgr(out + 7, &sgr_decimal[color.r]);
+      *out++ = ';';
+      out = PutSgr(out, &sgr_decimal[color.g]);
+      *out++ = ';';
+      out = PutSgr(out, &sgr_decimal[color.b]);
+      *out++ = 'm';
+      return out;
+  }
+}
+
+TGUI_INLINE char *EncodeCells(FrameEncoder_t *enc, const VTerm_t *vt, char *out, const ColorMode_t mode) {
+  bool full = !enc->valid;
+
+  // Terminal state while encoding, unknown at the start
+  int cursor_row = -1, cursor_col = -1;
+  bool colors_known = false;
+  Color_t fg = { 0 }, bg = { 0 };
+
+  // The last colors mapped; most cells have the same as their neighbour
+  Color_t fg_rgb = { 0 }, bg_rgb = { 0 };
+  Color_t fg_shown = TerminalColor(fg_rgb, mode), bg_shown = fg_shown;
+
+  for (unsigned short i = 1; i < vt->rows; i++) {
+    const Glyph_t *line = vt->screen[i];
+    Glyph_t *shown = enc->shown + (size_t)i * vt->cols;
+
+    for (unsigned short j = 1; j < vt->cols; j++) {
+      Glyph_t glyph = line[j];
+      if (mode != COLOR_TRUE) {
+        if (!SameColor(glyph.fg_color, fg_rgb)) {
+          fg_rgb = glyph.fg_color;
+          fg_shown = TerminalColor(fg_rgb, mode);
+        }
+        if (!SameColor(glyph.bg_color, bg_rgb)) {
+          bg_rgb = glyph.bg_color;
+          bg_shown = TerminalColor(bg_rgb, mode);
+        }
+        glyph.fg_color = fg_shown;
+        glyph.bg_color = bg_shown;
+      }
+
+      if (!full && SameGlyph(&glyph, &shown[j])) continue;
+      shown[j] = glyph;
+
+      // Never set cells stay as they are, like with PrintGlyph(...)
+      if (glyph.value == '\0') {
+        cursor_row = -1;
+        continue;
+      }
+
+      if (cursor_row != i || cursor_col != j)
+        out += sprintf(out, "\033[%d;%dH", i, j);
+
+      if (mode == COLOR_MONO) {
+        // Whatever colors were set before go away
+        if (!colors_known) {
+          memcpy(out, "\033[0m", 4);
+          out += 4;
+        }
+      } else {
+        if (!colors_known || !SameColor(fg, glyph.fg_color))
+          out = PutColor(out, glyph.fg_color, true, mode);
+        if (!colors_known || !SameColor(bg, glyph.bg_color))
+          out = PutColor(out, glyph.bg_color, false, mode);
+      }
+
+      *out++ = glyph.value;
+      fg = glyph.fg_color;
+      bg = glyph.bg_color;
+      colors_known = true;
+
+      // The cursor stays put after the last column
+      cursor_row = i;
+      cursor_col = j + 1 < vt->cols ? j + 1 : -1;
+    }
+  }
+
+  return out;
+}
+
+// The color the terminal gets for 'color' in 'mode', in the form that
+// EncodeFrame(...) compares cells in
+Color_t MapColor(ColorMode_t mode, Color_t color) {
+  ColorTablesInit();
+  switch (mode) {
+    case COLOR_256:  return TerminalColor(color, COLOR_256);
+    case COLOR_16:   return TerminalColor(color, COLOR_16);
+    case COLOR_MONO: return TerminalColor(color, COLOR_MONO);
+    default:         return color;
+  }
+}
+
+// Writes one glyph on its own, in the window's color mode. EncodeFrame(...)
+// is much cheaper for whole frames.
 void PrintGlyph(const Glyph_t *glyph, unsigned short row, unsigned short col) {
-  // TODO: Error checks (maybe not necessary?)
-  char buff[20];
-  // Set foreground color
-  sprintf(buff, "\033[38;2;%d;%d;%dm", 
-    glyph->fg_color.r, 
-    glyph->fg_color.g, 
-    glyph->fg_color.b
-  );
-  write(STDOUT_FILENO, buff, strlen(buff));
-  // Set background color
-  sprintf(buff, "\033[48;2;%d;%d;%dm", 
-    glyph->bg_color.r, 
-    glyph->bg_color.g, 
-    glyph->bg_color.b
-  );
-  write(STDOUT_FILENO, buff, strlen(buff));
-  // Set the cursor to the corret position
-  sprintf(buff, "\033[%d;%dH", row, col);
-  write(STDOUT_FILENO, buff, strlen(buff));
-  // Print the character
-  write(STDOUT_FILENO, &glyph->value, 1);
+  Color_t fg = MapColor(window_color_mode, glyph->fg_color);
+  Color_t bg = MapColor(window_color_mode, glyph->bg_color);
+
+  // Both colors, the cursor move and the character, plus the slack PutSgr(...) needs
+  char buff[96];
+  char *out = buff;
+
+  switch (window_color_mode) {
+    case COLOR_256:
+      out = PutColor(out, fg, true, COLOR_256);
+      out = PutColor(out, bg, false, COLOR_256);
+      break;
+    case COLOR_16:
+      out = PutColor(out, fg, true, COLOR_16);
+      out = PutColor(out, bg, false, COLOR_16);
+      break;
+    case COLOR_MONO:
+      break;
+    default:
+      out = PutColor(out, fg, true, COLOR_TRUE);
+      out = PutColor(out, bg, false, COLOR_TRUE);
+      break;
+  }
+
+  // Set the cursor to the corret position and print the character
+  out += sprintf(out, "\033[%d;%dH", row, col);
+  *out++ = glyph->value;
+  WriteWindow(buff, (size_t)(out - buff));
+}
+
+static char *EncodeTrueColor(FrameEncoder_t *enc, const VTerm_t *vt, char *out) {
+  return EncodeCells(enc, vt, out, COLOR_TRUE);
+}
+
+static char *Encode256Colors(FrameEncoder_t *enc, const VTerm_t *vt, char *out) {
+  return EncodeCells(enc, vt, out, COLOR_256);
+}
+
+static char *Encode16Colors(FrameEncoder_t *enc, const VTerm_t *vt, char *out) {
+  return EncodeCells(enc, vt, out, COLOR_16);
+}
+
+static char *EncodeMonochrome(FrameEncoder_t *enc, const VTerm_t *vt, char *out) {
+  return EncodeCells(enc, vt, out, COLOR_MONO);
+}
+
+// Returns the bytes that turn the previous frame into 'vt' (valid until the
+// next call) and remembers 'vt' as shown. Row 0 and col 0 are skipped:
+// PrintGlyph(...) puts them under row 1 and col 1, so they never show.
+const char *EncodeFrame(FrameEncoder_t *enc, const VTerm_t *vt, size_t *size) {
+  *size = 0;
+  if (vt->rows < 2 || vt->cols < 2) return enc->buff;
+
+  if (enc->rows != vt->rows || enc->cols != vt->cols || enc->shown == NULL) {
+    free(enc->shown);
+    free(enc->buff);
+    enc->rows = vt->rows;
+    enc->cols = vt->cols;
+    enc->valid = false;
+
+    // Worst case per cell: cursor move, both colors and the character. The
+    // colors are copied 15 bytes at a time, hence the slack at the end.
+    enc->capacity = (size_t)vt->rows * vt->cols * 64 + 64;
+    enc->shown = (Glyph_t*) malloc(sizeof(Glyph_t) * vt->rows * vt->cols);
+    enc->buff = (char*) malloc(enc->capacity);
+    if (enc->shown == NULL || enc->buff == NULL) {
+      ResetWindow();
+      fprintf(stderr, "  \033[31mError:\033[0m Couldn't allocate memory for the frame in \033[33mEncodeFrame(...)\033[0m\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  char *out;
+  switch (enc->mode) {
+    case COLOR_256:  out = Encode256Colors(enc, vt, enc->buff); break;
+    case COLOR_16:   out = Encode16Colors(enc, vt, enc->buff); break;
+    case COLOR_MONO: out = EncodeMonochrome(enc, vt, enc->buff); break;
+    default:         out = EncodeTrueColor(enc, vt, enc->buff); break;
+  }
+
+  enc->valid = true;
+  *size = (size_t)(out - enc->buff);
+  return enc->buff;
+}
+
+const char *EncodeWindow(const VTerm_t *vt, size_t *size) {
+  return EncodeFrame(&window_encoder, vt, size);
+}
+
+// Writes all of 'data' to stdout, also while stdout is non-blocking (it
+// shares the O_NONBLOCK of stdin when both are the same terminal)
+void WriteWindow(const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = TGUI_WRITE(data, size);
+    if (written > 0) {
+      data += written;
+      size -= (size_t)written;
+    } else if (written < 0 && (errno == EAGAIN || errno == EINTR)) {
+      struct pollfd pfd = { .fd = STDOUT_FILENO, .events = POLLOUT };
+      poll(&pfd, 1, -1);
+    } else {
+      // The terminal is gone, send everything next time
+      InvalidateWindow();
+      return;
+    }
+  }
+}
+
+// The next UpdateWindow(...) redraws every cell, e.g. after something else
+// wrote to the terminal
+void InvalidateWindow(void) {
+  EncoderInvalidate(&window_encoder);
 }
 
 void UpdateWindow(const VTerm_t *vt) {
-  for (unsigned short i = 0; i < vt->rows; i++)
-    for (unsigned short j = 0; j < vt->cols; j++)
-      PrintGlyph(&vt->screen[i][j], i, j);
+  size_t size;
+  const char *data = EncodeWindow(vt, &size);
+  WriteWindow(data, size);
 }
 
 Key_t GetKeyPressed(void) {
@@ -334,6 +825,19 @@ void DelayMs(unsigned long ms) {
   usleep(ms * 1000);
 }
 
+// Sleeps until there is something to read on stdin, at most 'ms'. Bytes
+// that getchar() already buffered don't count. A stdin that hung up or
+// failed never has anything, so that sleeps the whole 'ms' instead of
+// returning at once.
+bool WaitForInput(unsigned long ms) {
+  struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+  if (poll(&pfd, 1, (int)ms) <= 0) return false;
+  if (pfd.revents & POLLIN) return true;
+
+  if (pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) DelayMs(ms);
+  return false;
+}
+
 #undef TGUI_INCLUDE_IMPL
 #endif // TGUI_INCLUDE_IMPL
 
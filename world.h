@@ -0,0 +1,144 @@
+#ifndef WORLD_LIBRARY
+#define WORLD_LIBRARY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WORLD_CHUNK_BITS     6
+#define WORLD_CHUNK          (1 << WORLD_CHUNK_BITS)  // Cells per chunk side
+#define WORLD_FOOD_PER_CHUNK 12
+
+// Cell values
+#define WORLD_EMPTY 0
+#define WORLD_FOOD  1
+
+typedef struct WorldChunk WorldChunk_t;
+
+typedef struct World World_t;
+
+bool WorldInit(World_t *world, unsigned short rows, unsigned short cols, uint64_t seed);
+
+void WorldDeinit(World_t *world);
+
+WorldChunk_t *WorldGetChunk(World_t *world, unsigned short row, unsigned short col);
+
+bool WorldIsTouched(const World_t *world, unsigned short row, unsigned short col);
+
+bool WorldTakeFood(World_t *world, unsigned short row, unsigned short col);
+
+#ifdef WORLD_INCLUDE_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+
+// A board much bigger than the terminal. It is cut into square chunks that
+// are generated (from the seed and their position) the first time anything
+// looks at them, so memory grows with the explored area, not the world size.
+typedef struct WorldChunk {
+  uint16_t food_left;
+  uint8_t cells[WORLD_CHUNK * WORLD_CHUNK];
+} WorldChunk_t;
+
+typedef struct World {
+  // Same layout as Game_t: walls at rows 2 and rows - 1, cols 2 and cols - 2
+  unsigned short rows, cols;
+  unsigned chunk_rows, chunk_cols;
+
+  WorldChunk_t **chunks;  // chunk_rows * chunk_cols, NULL until touched
+  size_t chunks_touched;
+
+  uint64_t seed;
+} World_t;
+
+bool WorldInit(World_t *world, unsigned short rows, unsigned short cols, uint64_t seed) {
+  *world = (World_t) { 0 };
+  world->rows = rows;
+  world->cols = cols;
+  world->chunk_rows = (rows + WORLD_CHUNK - 1) >> WORLD_CHUNK_BITS;
+  world->chunk_cols = (cols + WORLD_CHUNK - 1) >> WORLD_CHUNK_BITS;
+  world->seed = seed;
+
+  world->chunks = calloc((size_t)world->chunk_rows * world->chunk_cols, sizeof(WorldChunk_t *));
+  return world->chunks != NULL;
+}
+
+void WorldDeinit(World_t *world) {
+  if (world->chunks == NULL) return;
+
+  size_t count = (size_t)world->chunk_rows * world->chunk_cols;
+  for (size_t i = 0; i < count; i++)
+    free(world->chunks[i]);
+
+  free(world->chunks); world->chunks = NULL;
+  world->chunks_touched = 0;
+}
+
+static uint64_t WorldHash(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+static void WorldGenerateChunk(const World_t *world, WorldChunk_t *chunk, unsigned cr, unsigned cc) {
+  memset(chunk->cells, WORLD_EMPTY, sizeof(chunk->cells));
+  chunk->food_left = 0;
+
+  uint64_t state = WorldHash(world->seed ^ ((uint64_t)cr << 32 | cc));
+  for (unsigned i = 0; i < WORLD_FOOD_PER_CHUNK; i++) {
+    state = WorldHash(state + 0x9E3779B97F4A7C15ull);
+    unsigned r = (unsigned)(state & (WORLD_CHUNK - 1));
+    unsigned c = (unsigned)((state >> 16) & (WORLD_CHUNK - 1));
+
+    // Only inside the walls
+    unsigned row = (cr << WORLD_CHUNK_BITS) + r, col = (cc << WORLD_CHUNK_BITS) + c;
+    if (row < 3 || row > (unsigned)world->rows - 2 || col < 3 || col > (unsigned)world->cols - 3)
+      continue;
+
+    if (chunk->cells[r * WORLD_CHUNK + c] == WORLD_EMPTY) {
+      chunk->cells[r * WORLD_CHUNK + c] = WORLD_FOOD;
+      chunk->food_left++;
+    }
+  }
+}
+
+// The chunk holding (row, col), generated on first use. NULL if the
+// position is outside the world or the chunk couldn't be allocated.
+WorldChunk_t *WorldGetChunk(World_t *world, unsigned short row, unsigned short col) {
+  if (row >= world->rows || col >= world->cols) return NULL;
+
+  unsigned cr = row >> WORLD_CHUNK_BITS, cc = col >> WORLD_CHUNK_BITS;
+  WorldChunk_t **slot = &world->chunks[(size_t)cr * world->chunk_cols + cc];
+
+  if (*slot == NULL) {
+    *slot = malloc(sizeof(WorldChunk_t));
+    if (*slot == NULL) return NULL;
+    WorldGenerateChunk(world, *slot, cr, cc);
+    world->chunks_touched++;
+  }
+
+  return *slot;
+}
+
+static inline uint8_t WorldChunkCell(const WorldChunk_t *chunk, unsigned short row, unsigned short col) {
+  return chunk->cells[(row & (WORLD_CHUNK - 1)) * WORLD_CHUNK + (col & (WORLD_CHUNK - 1))];
+}
+
+bool WorldIsTouched(const World_t *world, unsigned short row, unsigned short col) {
+  if (row >= world->rows || col >= world->cols) return false;
+  return world->chunks[(size_t)(row >> WORLD_CHUNK_BITS) * world->chunk_cols + (col >> WORLD_CHUNK_BITS)] != NULL;
+}
+
+bool WorldTakeFood(World_t *world, unsigned short row, unsigned short col) {
+  WorldChunk_t *chunk = WorldGetChunk(world, row, col);
+  if (chunk == NULL || WorldChunkCell(chunk, row, col) != WORLD_FOOD) return false;
+
+  chunk->cells[(row & (WORLD_CHUNK - 1)) * WORLD_CHUNK + (col & (WORLD_CHUNK - 1))] = WORLD_EMPTY;
+  chunk->food_left--;
+  return true;
+}
+
+#undef WORLD_INCLUDE_IMPL
+#endif // WORLD_INCLUDE_IMPL
+
+#endif // WORLD_LIBRARY